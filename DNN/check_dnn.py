@@ -0,0 +1,88 @@
+#!/usr/bin/env python
+"""
+Check that the DNN score computed in C++ (dnn_score, DNNModel) agrees with
+the Keras prediction of eval.py on a processed ntuple.
+
+python check_dnn.py -M rerun_staug22/nom/best_model.h5 -W dnn_st.txt -I processed.root
+"""
+import os
+import sys
+os.environ["CUDA_VISIBLE_DEVICES"] = ""
+
+import numpy as np
+import uproot
+from optparse import OptionParser
+
+def read_weights(fname):
+    """input names and layers of a DNNModel weights file"""
+    tokens = []
+    with open(fname) as f:
+        for line in f:
+            tokens += line.split("#")[0].split()
+    pos = 0
+    def take(n):
+        nonlocal pos
+        pos += n
+        return tokens[pos-n:pos]
+    names, scaling, layers = [], None, []
+    while pos < len(tokens):
+        key = take(1)[0]
+        if key == "inputs":
+            names = take(int(take(1)[0]))
+        elif key == "scaling":
+            n = int(take(1)[0])
+            scaling = (np.array(take(n), float), np.array(take(n), float))
+        elif key == "dense":
+            nin, nout, act = take(3)
+            nin, nout = int(nin), int(nout)
+            w = np.array(take(nin*nout), float).reshape(nin, nout)
+            layers.append((w, np.array(take(nout), float), act, True))
+        elif key == "affine":
+            n, act = take(2)
+            n = int(n)
+            layers.append((np.array(take(n), float), np.array(take(n), float), act, False))
+    return names, scaling, layers
+
+def forward(x, scaling, layers):
+    """numpy version of DNNModel::evaluate"""
+    acts = {"linear": lambda v: v, "relu": lambda v: np.maximum(v, 0), "tanh": np.tanh,
+            "sigmoid": lambda v: 1/(1+np.exp(-v)), "elu": lambda v: np.where(v > 0, v, np.expm1(v)),
+            "selu": lambda v: 1.0507009873554805*np.where(v > 0, v, 1.6732632423543772*np.expm1(v)),
+            "softmax": lambda v: np.exp(v - v.max(1, keepdims=True))/np.exp(v - v.max(1, keepdims=True)).sum(1, keepdims=True)}
+    if scaling is not None:
+        x = (x - scaling[0]) * scaling[1]
+    for w, b, act, dense in layers:
+        x = acts[act](x.dot(w) + b if dense else x*w + b)
+    return x
+
+if __name__ == "__main__":
+    parser = OptionParser(usage="%prog [options]")
+    parser.add_option("-M", "--model", dest="model", type="string", default="", help="Keras model (best_model.h5)")
+    parser.add_option("-W", "--weights", dest="weights", type="string", default="", help="Weights file from export_weights.py")
+    parser.add_option("-I", "--infile", dest="infile", type="string", default="", help="Ntuple processed with --dnn")
+    parser.add_option("-T", "--tree", dest="tree", type="string", default="outputTree2", help="Tree name")
+    parser.add_option("--tol", dest="tol", type="float", default=1e-4, help="Allowed absolute difference")
+    (options, args) = parser.parse_args()
+
+    import tensorflow as tf
+    names, scaling, layers = read_weights(options.weights)
+    tree = uproot.open(options.infile)[options.tree]
+    x = np.stack([tree[n].array(library="np").astype(np.float32) for n in names], axis=1)
+    if len(x) == 0:
+        print("No events in " + options.infile)
+        sys.exit(0)
+
+    keras = tf.keras.models.load_model(options.model).predict(x, batch_size=128)[:,1]
+    exported = forward(x.astype(np.float64), scaling, layers)[:,1]
+    diffs = {"export vs keras": np.abs(exported - keras).max()}
+    if "dnn_score" in tree.keys():
+        diffs["C++ vs keras"] = np.abs(tree["dnn_score"].array(library="np") - keras).max()
+    else:
+        print("dnn_score not in " + options.infile + ", only the export is checked")
+
+    ok = True
+    for name, d in diffs.items():
+        print("%s: max |difference| = %.3g over %d events" % (name, d, len(x)))
+        ok = ok and d < options.tol
+    print("OK" if ok else "FAILED")
+    sys.exit(0 if ok else 1)
@@ -11,6 +11,7 @@ import numpy as np
 import tensorflow as tf
 import matplotlib.pyplot as plt
 from keras.callbacks import EarlyStopping, ModelCheckpoint
+from utils.columns import read_columns
 
 base_dir = os.getcwd().replace("DNN","") # Upper directory
 processed = "aug22"
@@ -92,8 +93,8 @@ for syst in systs:
                     print("No events : "+f)
                     continue
                 print(f)
-                pd_data = tree.arrays(inputvars,library="pd")
-                pd_weight = tree.arrays(weights,library="np")
+                pd_data = read_columns(f_dir, "outputTree2", inputvars)
+                pd_weight = read_columns(f_dir, "outputTree2", weights)
                 pred_data = np.array(pd_data.filter(items = inputvars))
                 pred = model.predict(pred_data,batch_size=128)
                 pred = pred[:,1].tolist()
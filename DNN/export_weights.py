@@ -0,0 +1,130 @@
+#!/usr/bin/env python
+"""
+Export a Keras model from train.py to the text format read by
+nanoaodframe/src/DNNModel.cpp, so that the DNN score is computed while
+processing (TopLFVAnalyzer, --dnn option of processonefile.py) instead of
+re-reading the ntuples in eval.py.
+
+BatchNormalization layers are folded into the following Dense layer, input
+names are translated to the TopLFVAnalyzer column names.
+
+python export_weights.py -M rerun_staug22/nom/best_model.h5 -C st -O dnn_st.txt
+"""
+import os
+os.environ["CUDA_VISIBLE_DEVICES"] = ""
+
+import pickle
+import numpy as np
+from optparse import OptionParser
+
+# same order as eval.py
+inputvars = {
+    "st": ["Sel_muon1pt","Sel_muon1eta",
+        "Sel_tau1pt","Sel_tau1eta","Sel_tau1mass",
+        "Sel2_jet1pt","Sel2_jet2pt","Sel2_jet3pt",
+        "Sel2_jet1eta","Sel2_jet2eta","Sel2_jet3eta",
+        "Sel2_jet1mass","Sel2_jet2mass","Sel2_jet3mass",
+        "Sel2_jet1btag","Sel2_jet2btag","Sel2_jet3btag",
+        "Sys_METpt","Sys_METphi",
+        "chi2","chi2_SMW_mass","chi2_SMTop_mass",
+        "chi2_wqq_dEta","chi2_wqq_dPhi","chi2_wqq_dR",
+        "mutau_mass","mutau_dEta","mutau_dPhi","mutau_dR",
+        ],
+}
+
+# channels of eval.py whose inputs TopLFVAnalyzer does not compute, not exported
+not_covered = {
+    "tt": "the tt model reads Sel2_jet4*, chi2_lfvTop_mass and the chi2_lfvj* variables, which TopLFVAnalyzer does not define; score tt with eval.py",
+}
+
+def column_name(var):
+    """training ntuple name -> TopLFVAnalyzer column"""
+    fixed = {"Sel_muon1pt": "Muon1_pt", "Sel_muon1eta": "Muon1_eta",
+             "Sel_tau1pt": "Tau1_pt", "Sel_tau1eta": "Tau1_eta", "Sel_tau1mass": "Tau1_mass",
+             "Sys_METpt": "MET_pt", "Sys_METphi": "MET_phi"}
+    if var in fixed:
+        return fixed[var]
+    if var.startswith("Sel2_jet"):
+        # Sel2_jet1pt -> Jet1_pt, Sel2_jet1btag -> Jet1_btagDeepFlavB
+        n, obs = var[len("Sel2_jet")], var[len("Sel2_jet")+1:]
+        return "Jet" + n + "_" + ("btagDeepFlavB" if obs == "btag" else obs)
+    return var
+
+def fold_batchnorm(layer):
+    """BatchNormalization -> (scale, shift)"""
+    cfg = layer.get_config()
+    weights = layer.get_weights()
+    gamma = weights.pop(0) if cfg.get("scale", True) else 1.0
+    beta = weights.pop(0) if cfg.get("center", True) else 0.0
+    mean, var = weights
+    scale = gamma / np.sqrt(var + cfg["epsilon"])
+    return scale * np.ones_like(mean), beta - mean * scale
+
+def collect_layers(model):
+    """list of (kind, activation, w, b) with BatchNormalization folded into the next Dense"""
+    layers = []
+    pending = None
+    for layer in model.layers:
+        kind = layer.__class__.__name__
+        if kind in ("Flatten", "Dropout", "InputLayer"):
+            continue
+        if kind == "BatchNormalization":
+            scale, shift = fold_batchnorm(layer)
+            if pending is not None:
+                scale, shift = pending[0] * scale, pending[1] * scale + shift
+            pending = (scale, shift)
+        elif kind == "Dense":
+            w, b = layer.get_weights()
+            if pending is not None:
+                # W (s x + t) + b = (diag(s) W) x + (t W + b)
+                b = pending[1].dot(w) + b
+                w = pending[0][:, None] * w
+                pending = None
+            layers.append(("dense", layer.get_config()["activation"], w, b))
+        else:
+            raise RuntimeError("layer type " + kind + " is not supported by DNNModel")
+    if pending is not None:
+        layers.append(("affine", "linear", pending[0], pending[1]))
+    return layers
+
+def write(outname, names, layers, offset=None, scale=None):
+    fmt = lambda v: " ".join("%.9g" % x for x in np.ravel(v))
+    with open(outname, "w") as f:
+        f.write("# exported by DNN/export_weights.py\n")
+        f.write("inputs %d %s\n" % (len(names), " ".join(names)))
+        if offset is not None:
+            f.write("scaling %d\n%s\n%s\n" % (len(names), fmt(offset), fmt(scale)))
+        for kind, act, w, b in layers:
+            if kind == "dense":
+                f.write("dense %d %d %s\n" % (w.shape[0], w.shape[1], act))
+                for row in w:
+                    f.write(fmt(row) + "\n")
+            else:
+                f.write("affine %d %s\n%s\n" % (len(w), act, fmt(w)))
+            f.write(fmt(b) + "\n")
+
+if __name__ == "__main__":
+    parser = OptionParser(usage="%prog [options]")
+    parser.add_option("-M", "--model", dest="model", type="string", default="", help="Keras model (best_model.h5)")
+    parser.add_option("-C", "--channel", dest="channel", type="string", default="st", help="Input variable set: " + ", ".join(inputvars))
+    parser.add_option("-O", "--outfile", dest="outfile", type="string", default="dnn.txt", help="Output weights file")
+    parser.add_option("--scaler", dest="scaler", type="string", default="", help="Pickled MinMaxScaler applied to the inputs in training, if any")
+    (options, args) = parser.parse_args()
+    if options.channel in not_covered:
+        parser.error("channel " + options.channel + " cannot be exported: " + not_covered[options.channel])
+    if options.channel not in inputvars:
+        parser.error("unknown channel " + options.channel + ", exported channels: " + ", ".join(inputvars))
+
+    import tensorflow as tf
+    model = tf.keras.models.load_model(options.model)
+    names = [column_name(v) for v in inputvars[options.channel]]
+    offset, scale = None, None
+    if options.scaler != "":
+        with open(options.scaler, "rb") as f:
+            scaler = pickle.load(f)
+        # x * scale_ + min_ = (x - offset) * scale_
+        scale = scaler.scale_
+        offset = -scaler.min_ / scaler.scale_
+    layers = collect_layers(model)
+    write(options.outfile, names, layers, offset, scale)
+    print("Wrote " + options.outfile + " with %d inputs and %d layers" % (len(names), len(layers)))
@@ -12,6 +12,7 @@ import matplotlib.pyplot as plt
 import pickle
 from keras.callbacks import EarlyStopping, ModelCheckpoint
 from utils.plots import *
+from utils.columns import read_columns
 from sklearn.preprocessing import MinMaxScaler
 from sklearn.metrics import roc_curve, roc_auc_score
 
@@ -73,13 +74,10 @@ for p in ["ST","TT"]:
     print("train out dir:" , train_outdir)
     os.makedirs(train_outdir, exist_ok=True)
 
-    sig_tree = uproot.open(sig_filedir)["outputTree2"]
-    bkg1_tree = uproot.open(bkg1_filedir)["outputTree2"]
-    bkg2_tree = uproot.open(bkg2_filedir)["outputTree2"]
-
-    df_sig = sig_tree.arrays(inputvars,library="pd")
-    df_bkg1 = bkg1_tree.arrays(inputvars,library="pd")
-    df_bkg2 = bkg2_tree.arrays(inputvars,library="pd")
+    # exported .npy columns (nanoaodrdataframe --export) when present, the tree otherwise
+    df_sig = read_columns(sig_filedir, "outputTree2", inputvars)
+    df_bkg1 = read_columns(bkg1_filedir, "outputTree2", inputvars)
+    df_bkg2 = read_columns(bkg2_filedir, "outputTree2", inputvars)
     df_bkg = pd.concat([df_bkg1,df_bkg2])
 
     ntotsig = len(df_sig)
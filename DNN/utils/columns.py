@@ -0,0 +1,31 @@
+import os
+import json
+import numpy as np
+import pandas as pd
+import uproot
+
+# Columns written next to a processed ntuple by nanoaodrdataframe --export:
+# x.root -> x_columns/ with one float32 .npy file per column and schema.json
+
+def columns_dir(rootfile):
+    return rootfile[:-len(".root")] + "_columns"
+
+def load_columns(directory, names):
+    # memory mapped arrays, nothing is read or converted until used
+    with open(os.path.join(directory, "schema.json")) as f:
+        schema = json.load(f)
+    files = {c["name"]: c["file"] for c in schema["columns"]}
+    missing = [n for n in names if n not in files]
+    if missing:
+        return None
+    return {n: np.load(os.path.join(directory, files[n]), mmap_mode="r") for n in names}
+
+def read_columns(rootfile, treename, names):
+    # exported columns when they have all names, the ROOT tree otherwise
+    directory = columns_dir(rootfile)
+    if os.path.isfile(os.path.join(directory, "schema.json")):
+        columns = load_columns(directory, names)
+        if columns is not None:
+            return pd.DataFrame(columns, columns=names)
+        print("Not all columns in "+directory+", reading "+rootfile)
+    return uproot.open(rootfile)[treename].arrays(names, library="pd")
@@ -23,6 +23,7 @@ if __name__=='__main__':
     parser.add_option("-J", "--json",  dest="json", type="string", default="", help="Select events using this JSON file, meaningful only for data")
     parser.add_option("--saveallbranches", dest="saveallbranches", action="store_true", default=False, help="Save all branches. False by default")
     parser.add_option("--globaltag", dest="globaltag", type="string", default="", help="Global tag to be used in JetMET corrections")
+    parser.add_option("--dnn", dest="dnn", type="string", default="", help="DNN weights from DNN/export_weights.py, stores dnn_score if given")
     (options, args) = parser.parse_args()
 
     if "SingleMuon2016" in options.infile:
@@ -38,6 +39,7 @@ if __name__=='__main__':
     t = ROOT.TChain("Events")
     t.Add(options.infile)
     aproc = ROOT.TopLFVAnalyzer(t, options.outfile, options.year, options.syst, options.json, options.globaltag)
+    aproc.dnnfile = options.dnn
     aproc.setupAnalysis()
     aproc.run(options.saveallbranches, "Events")
 
@@ -12,6 +12,7 @@
 #SBATCH --comment python
 #SBATCH --time 20:00:00
 #SBATCH --hint=compute_bound
+#SBATCH --requeue
 
 year=$1
 indir=$2
@@ -23,5 +24,5 @@ syst=$7
 
 cd $workdir
 source /cvmfs/sft.cern.ch/lcg/views/LCG_103/x86_64-centos7-gcc12-opt/setup.sh
-echo "python processonedataset.py -Y $year -S ${syst} -I $indir -O ${outpath}/${outfile} 2>&1 | tee ${logdir}/${outfile%%root}log"
-python processonedataset.py -Y $year -S ${syst} -I $indir -O ${outpath}/${outfile} 2>&1 | tee ${logdir}/${outfile%%root}log
+echo "./nanoaodrdataframe --checkpoint -Y $year -S ${syst} -j ${SLURM_CPUS_PER_TASK:-1} -D $indir -O ${outpath}/${outfile} 2>&1 | tee -a ${logdir}/${outfile%%root}log"
+./nanoaodrdataframe --checkpoint -Y $year -S ${syst} -j ${SLURM_CPUS_PER_TASK:-1} -D $indir -O ${outpath}/${outfile} 2>&1 | tee -a ${logdir}/${outfile%%root}log
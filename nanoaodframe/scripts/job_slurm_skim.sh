@@ -12,6 +12,7 @@
 #SBATCH --comment python
 #SBATCH --time 03:00:00
 #SBATCH --hint=compute_bound
+#SBATCH --requeue
 
 year=$1
 infile=$2
@@ -22,5 +23,5 @@ logdir=$6
 
 cd $workdir
 source /cvmfs/sft.cern.ch/lcg/views/LCG_103/x86_64-centos7-gcc12-opt/setup.sh
-echo "python skimonefile.py -Y $year -I $infile -O ${outpath}/${outfile} 2>&1 | tee ${logdir}/${outfile%%root}log"
-python skimonefile.py -Y $year -I $infile -O ${outpath}/${outfile} 2>&1 | tee ${logdir}/${outfile%%root}log
+echo "./nanoaodrdataframe --checkpoint --skim -Y $year -I $infile -O ${outpath}/${outfile} 2>&1 | tee -a ${logdir}/${outfile%%root}log"
+./nanoaodrdataframe --checkpoint --skim -Y $year -I $infile -O ${outpath}/${outfile} 2>&1 | tee -a ${logdir}/${outfile%%root}log
@@ -0,0 +1,27 @@
+#!/bin/bash
+
+#SBATCH -J LFV_tasks
+#SBATCH -p gpu,cpu -x gpu-0-2,compute-0-3
+#SBATCH -N 1
+#SBATCH --output=/dev/null
+#SBATCH --error=/dev/null
+#SBATCH --open-mode=append
+#SBATCH --ntasks=1
+#SBATCH --cpus-per-task=16
+#SBATCH --mem=16gb
+#SBATCH --comment python
+#SBATCH --time 20:00:00
+#SBATCH --hint=compute_bound
+#SBATCH --requeue
+
+# all tasks of a manifest (scripts/process.py --manifest) in one allocation
+year=$1
+manifest=$2
+outpath=$3
+workdir=$4
+
+cd $workdir
+source /cvmfs/sft.cern.ch/lcg/views/LCG_103/x86_64-centos7-gcc12-opt/setup.sh
+nworkers=${SLURM_CPUS_PER_TASK:-1}
+echo "./runtasks -m $manifest -Y $year -O $outpath -j $nworkers --mem $(( ${SLURM_MEM_PER_NODE:-16384} / nworkers )) 2>&1 | tee -a ${outpath}/runtasks.log"
+./runtasks -m $manifest -Y $year -O $outpath -j $nworkers --mem $(( ${SLURM_MEM_PER_NODE:-16384} / nworkers )) 2>&1 | tee -a ${outpath}/runtasks.log
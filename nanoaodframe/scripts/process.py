@@ -9,6 +9,7 @@ parser.add_argument("-S", "--syst", dest="syst", type=str, default="theory", hel
 parser.add_argument("-D", "--dataset", dest="dataset", action="store", nargs="+", default=[], help="Put dataset folder name (eg. TTTo2L2Nu) to process specific one.")
 parser.add_argument("-F", "--dataOrMC", dest="dataOrMC", type=str, default="", help="data or mc flag, if you want to process data-only or mc-only")
 parser.add_argument("--dry", dest="dry", action="store_true", default=False, help="dryrun: not submitting jobs to slurm")
+parser.add_argument("--manifest", dest="manifest", type=str, default="", help="write the jobs to this task list for tools/runtasks instead of submitting them")
 options = parser.parse_args()
 
 year = options.year
@@ -86,6 +87,13 @@ for ds in dataset_list:
                 parameters.append([year, ds, outdir, outfname, src[2:]])
 
 
+if options.manifest != "":
+    with open(options.manifest, "w") as f:
+        for item in parameters:
+            f.write(item[1].split('/')[-1] + " " + item[1] + " " + item[4] + "\n")
+    print("Wrote %d tasks to %s, run them with: ./runtasks -m %s -Y %s -O %s -j <nworkers>" % (len(parameters), options.manifest, options.manifest, year, tgdir))
+    sys.exit(0)
+
 for item in parameters:
     runString = "sbatch -J " + item[0] + '_' + item[3] + " scripts/job_slurm_process.sh " + item[0] + " " + item[1] + " " + item[2] + " " + item[3] + " " + workdir + " " +logdir + " " + item[4]
 
@@ -0,0 +1,184 @@
+/*
+ * ColumnExport.cpp
+ *
+ *  Columns as memory mappable .npy files.
+ */
+
+#include "ColumnExport.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "json/json.h"
+
+using namespace std;
+
+namespace {
+// magic, version 1.0, header length, dict padded with spaces to a multiple of 64 bytes (numpy format 1.0)
+const int kHeaderSize = 128;
+}
+
+ColumnExport::ColumnExport(std::string dir, std::vector<std::string> names, std::vector<std::string> sourcetypes, unsigned int nslots, size_t bufferrows)
+:_dir(dir), _names(names), _sourcetypes(sourcetypes), _bufferrows(std::max<size_t>(1, bufferrows)), _buffers(std::max(1u, nslots))
+{
+    for (size_t pos = dir.find('/', 1); ; pos = dir.find('/', pos+1)) {
+        mkdir(dir.substr(0, pos).c_str(), 0755);
+        if (pos == std::string::npos) break;
+    }
+    for (auto &b : _buffers) b.reserve(_bufferrows * _names.size());
+    for (auto &name : _names) {
+        _files.emplace_back(new std::ofstream(_dir + "/" + name + ".npy", std::ios::binary | std::ios::trunc));
+        if (!_files.back()->good()) {
+            cout << "ERROR! ColumnExport: cannot write " << _dir << "/" << name << ".npy" << endl;
+            _valid = false;
+            continue;
+        }
+        writeHeader(*_files.back(), 0);
+    }
+    _column.resize(_bufferrows);
+}
+
+void ColumnExport::writeHeader(std::ostream &out, ULong64_t nrows)
+{
+    // the files hold the raw floats of the (little endian) host
+    std::string dict = "{'descr': '<f4', 'fortran_order': False, 'shape': (" + std::to_string(nrows) + ",), }";
+    dict.resize(kHeaderSize - 10 - 1, ' ');
+    dict += '\n';
+    const uint16_t len = dict.size();
+    out.seekp(0);
+    out.write("\x93NUMPY\x01\x00", 8);
+    out.put(char(len & 0xff));
+    out.put(char(len >> 8));
+    out.write(dict.data(), dict.size());
+}
+
+bool ColumnExport::writeSchema(const std::string &dir, const std::vector<std::string> &names, const std::vector<std::string> &sourcetypes, ULong64_t nrows)
+{
+    Json::Value schema;
+    schema["format"] = "npy";
+    schema["entries"] = Json::UInt64(nrows);
+    for (size_t i=0; i<names.size(); i++) {
+        Json::Value column;
+        column["name"] = names[i];
+        column["file"] = names[i] + ".npy";
+        column["dtype"] = "<f4";
+        column["source"] = i < sourcetypes.size() ? sourcetypes[i] : "";
+        schema["columns"].append(column);
+    }
+    std::ofstream out(dir + "/schema.json", std::ios::trunc);
+    out << schema;
+    return out.good();
+}
+
+void ColumnExport::fill(unsigned int slot, const floats &row)
+{
+    std::vector<float> &buffer = _buffers[slot];
+    buffer.insert(buffer.end(), row.begin(), row.end());
+    if (buffer.size() >= _bufferrows * _names.size()) {
+        std::lock_guard<std::mutex> lock(_lock);
+        flush(buffer);
+    }
+}
+
+void ColumnExport::flush(std::vector<float> &buffer)
+{
+    const size_t ncols = _names.size();
+    const size_t nrows = ncols > 0 ? buffer.size() / ncols : 0;
+    if (_column.size() < nrows) _column.resize(nrows);
+    // the buffer is row-major, the files one column each
+    for (size_t c=0; c<ncols; c++) {
+        for (size_t r=0; r<nrows; r++) _column[r] = buffer[r*ncols + c];
+        _files[c]->write(reinterpret_cast<const char *>(_column.data()), nrows * sizeof(float));
+    }
+    _nrows += nrows;
+    buffer.clear();
+}
+
+ULong64_t ColumnExport::finish()
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    if (_finished) return _nrows;
+    _finished = true;
+    for (auto &b : _buffers) flush(b);
+    for (size_t c=0; c<_files.size(); c++) {
+        writeHeader(*_files[c], _nrows);
+        _files[c]->close();
+        if (_files[c]->fail()) {
+            cout << "ERROR! ColumnExport: writing " << _dir << "/" << _names[c] << ".npy failed" << endl;
+            _valid = false;
+        }
+    }
+    if (!writeSchema(_dir, _names, _sourcetypes, _nrows)) {
+        cout << "ERROR! ColumnExport: cannot write " << _dir << "/schema.json" << endl;
+        _valid = false;
+    }
+    cout << "ColumnExport: " << _nrows << " rows of " << _names.size() << " columns in " << _dir << endl;
+    return _nrows;
+}
+
+bool ColumnExport::concatenate(const std::vector<std::string> &dirs, const std::string &outdir)
+{
+    std::vector<std::string> names;
+    std::vector<std::string> sourcetypes;
+    std::vector<ULong64_t> nrows;
+    for (auto &dir : dirs) {
+        std::ifstream in(dir + "/schema.json");
+        Json::Value schema;
+        if (!in.good() || !(in >> schema) || !schema.isMember("columns")) {
+            cout << "ERROR! ColumnExport: cannot read " << dir << "/schema.json" << endl;
+            return false;
+        }
+        std::vector<std::string> dirnames;
+        for (auto &column : schema["columns"]) dirnames.push_back(column["name"].asString());
+        if (names.empty()) {
+            names = dirnames;
+            for (auto &column : schema["columns"]) sourcetypes.push_back(column["source"].asString());
+        } else if (dirnames != names) {
+            cout << "ERROR! ColumnExport: the columns of " << dir << " do not match those of " << dirs[0] << endl;
+            return false;
+        }
+        nrows.push_back(schema["entries"].asUInt64());
+    }
+
+    ColumnExport out(outdir, names, sourcetypes);
+    if (!out.isValid()) return false;
+    std::vector<char> chunk(1 << 20);
+    for (size_t c=0; c<names.size(); c++) {
+        for (size_t d=0; d<dirs.size(); d++) {
+            std::ifstream in(dirs[d] + "/" + names[c] + ".npy", std::ios::binary);
+            unsigned char prefix[10];
+            if (!in.read(reinterpret_cast<char *>(prefix), sizeof(prefix)) || std::memcmp(prefix, "\x93NUMPY", 6) != 0) {
+                cout << "ERROR! ColumnExport: " << dirs[d] << "/" << names[c] << ".npy is not a .npy file" << endl;
+                return false;
+            }
+            in.seekg(10 + (prefix[8] | prefix[9] << 8));
+            for (ULong64_t left = nrows[d] * sizeof(float); left > 0; ) {
+                size_t n = std::min<ULong64_t>(left, chunk.size());
+                if (!in.read(chunk.data(), n)) {
+                    cout << "ERROR! ColumnExport: " << dirs[d] << "/" << names[c] << ".npy is truncated" << endl;
+                    return false;
+                }
+                out._files[c]->write(chunk.data(), n);
+                left -= n;
+            }
+        }
+    }
+    for (auto n : nrows) out._nrows += n;
+    out.finish();
+    return out.isValid();
+}
+
+void ColumnExport::remove(const std::string &dir)
+{
+    std::ifstream in(dir + "/schema.json");
+    Json::Value schema;
+    if (!in.good() || !(in >> schema)) return;
+    for (auto &column : schema["columns"]) unlink((dir + "/" + column["file"].asString()).c_str());
+    unlink((dir + "/schema.json").c_str());
+    rmdir(dir.c_str());
+}
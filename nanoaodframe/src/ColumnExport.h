@@ -0,0 +1,88 @@
+/*
+ * ColumnExport.h
+ *
+ *  Writes RDataFrame columns as uncompressed NumPy .npy files, one per
+ *  column, plus schema.json, so DNN/train.py and eval.py can memory map
+ *  them (numpy.load(f, mmap_mode="r")) instead of converting ROOT files:
+ *   - every column is stored as little endian float32 ('<f4'), the type
+ *     the networks take, one row per entry in the same order in all files
+ *   - every slot fills its own row buffer; a full buffer is appended to all
+ *     files at once, so the rows of the files stay aligned
+ *   - the .npy headers have a fixed size and get the number of rows when
+ *     the event loop ends
+ *  schema.json lists the files with their dtype and source column type,
+ *  and the number of rows. concatenate() appends the exports of several
+ *  parts in order.
+ *  ColumnExportHelper is the RDataFrame action (Book) that fills a
+ *  ColumnExport from a row column (RVec<float> of the exported columns).
+ */
+
+#ifndef COLUMNEXPORT_H_
+#define COLUMNEXPORT_H_
+
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ROOT/RDataFrame.hxx"
+#include "utility.h"
+
+class ColumnExport {
+public:
+    ColumnExport(std::string dir, std::vector<std::string> names, std::vector<std::string> sourcetypes, unsigned int nslots=1, size_t bufferrows=4096);
+
+    bool isValid() const { return _valid; }
+    const std::string &dir() const { return _dir; }
+    // one value per column, in the order of the names
+    void fill(unsigned int slot, const floats &row);
+    // appends the remaining rows, writes the final headers and schema.json; returns the number of rows
+    ULong64_t finish();
+
+    // appends the exports in dirs (same columns) into outdir, false if they do not match
+    static bool concatenate(const std::vector<std::string> &dirs, const std::string &outdir);
+    // deletes the column files listed in schema.json, schema.json and the directory
+    static void remove(const std::string &dir);
+
+private:
+    // appends the rows of buffer to the files and empties it, with _lock held
+    void flush(std::vector<float> &buffer);
+    static void writeHeader(std::ostream &out, ULong64_t nrows);
+    static bool writeSchema(const std::string &dir, const std::vector<std::string> &names, const std::vector<std::string> &sourcetypes, ULong64_t nrows);
+
+    std::string _dir;
+    std::vector<std::string> _names;
+    std::vector<std::string> _sourcetypes;
+    size_t _bufferrows;
+    bool _valid = true;
+    bool _finished = false;
+    // row-major buffer of every slot
+    std::vector<std::vector<float>> _buffers;
+    std::vector<std::unique_ptr<std::ofstream>> _files;
+    std::vector<float> _column;
+    ULong64_t _nrows = 0;
+    std::mutex _lock;
+};
+
+class ColumnExportHelper : public ROOT::Detail::RDF::RActionImpl<ColumnExportHelper> {
+public:
+    using Result_t = ULong64_t;
+
+    ColumnExportHelper(std::shared_ptr<ColumnExport> out) : _out(out), _nrows(std::make_shared<ULong64_t>(0)) {}
+    ColumnExportHelper(ColumnExportHelper &&) = default;
+    ColumnExportHelper(const ColumnExportHelper &) = delete;
+
+    std::shared_ptr<ULong64_t> GetResultPtr() const { return _nrows; }
+    void Initialize() {}
+    void InitTask(TTreeReader *, unsigned int) {}
+    void Exec(unsigned int slot, const floats &row) { _out->fill(slot, row); }
+    void Finalize() { *_nrows = _out->finish(); }
+    std::string GetActionName() { return "ColumnExport"; }
+
+private:
+    std::shared_ptr<ColumnExport> _out;
+    std::shared_ptr<ULong64_t> _nrows;
+};
+
+#endif /* COLUMNEXPORT_H_ */
@@ -0,0 +1,36 @@
+/*
+ * CorrectionAdapter.cpp
+ *
+ *  Batched evaluation of a correctionlib correction over its systematic variations.
+ */
+
+#include "CorrectionAdapter.h"
+
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+CorrectionAdapter::CorrectionAdapter(correction::Correction::Ref corr, unsigned int ninputs, const std::vector<correction::Variable::Type> &fixed,
+                                     const std::vector<std::string> &systs, unsigned int nslots)
+:_corr(corr), _systs(systs)
+{
+    unsigned int nargs = ninputs + fixed.size() + 1;
+    if (_corr->inputs().size() != nargs) {
+        cout << "ERROR! Correction " << _corr->name() << " expects " << _corr->inputs().size()
+             << " inputs, adapter is configured with " << nargs << endl;
+    }
+
+    // numeric inputs are placeholders, categories are filled once here
+    std::vector<correction::Variable::Type> args(ninputs, 0.0);
+    args.insert(args.end(), fixed.begin(), fixed.end());
+    args.emplace_back(std::string(""));
+
+    _buffers.resize(std::max(nslots, 1u));
+    for (auto &slotbuffers : _buffers) {
+        for (auto &syst : _systs) {
+            slotbuffers.push_back(args);
+            slotbuffers.back().back() = syst;
+        }
+    }
+}
@@ -0,0 +1,55 @@
+/*
+ * CorrectionAdapter.h
+ *
+ *  Batched evaluation of a correctionlib correction over its systematic
+ *  variations (nom/up/down).
+ *  The argument vectors, including the string categories (ID name, WP,
+ *  syst), are built once at setup for every RDataFrame slot; per object only
+ *  the numeric inputs are overwritten, so evaluating a collection does not
+ *  allocate.
+ *
+ *  Argument layout expected by the correction:
+ *      (numeric inputs..., fixed categories..., syst)
+ *  e.g. tau_energy_scale: (pt, eta, dm, genmatch, "DeepTau2017v2p1", syst)
+ *       DeepTau2017v2p1VSe: (|eta|, genmatch, wp, syst)
+ */
+
+#ifndef CORRECTIONADAPTER_H_
+#define CORRECTIONADAPTER_H_
+
+#include <string>
+#include <vector>
+
+#include "correction.h"
+
+class CorrectionAdapter {
+public:
+    CorrectionAdapter(correction::Correction::Ref corr, unsigned int ninputs, const std::vector<correction::Variable::Type> &fixed,
+                      const std::vector<std::string> &systs = {"nom", "up", "down"}, unsigned int nslots = 1);
+
+    unsigned int nvariations() const { return _systs.size(); }
+    unsigned int nslots() const { return _buffers.size(); }
+
+    // evaluates all variations for one object, out must hold nvariations() values
+    // inputs must be given as int or double, in the order of the correction inputs
+    template <typename... Args>
+    void evaluate(unsigned int slot, float *out, Args... inputs)
+    {
+        static_assert(sizeof...(Args) > 0, "CorrectionAdapter needs at least one numeric input");
+        std::vector<std::vector<correction::Variable::Type>> &buffers = _buffers[slot];
+        for (unsigned int v=0; v<buffers.size(); v++) {
+            std::vector<correction::Variable::Type> &args = buffers[v];
+            unsigned int k = 0;
+            ((args[k++] = inputs), ...);
+            out[v] = _corr->evaluate(args);
+        }
+    }
+
+private:
+    correction::Correction::Ref _corr;
+    std::vector<std::string> _systs;
+    // [slot][variation][argument]
+    std::vector<std::vector<std::vector<correction::Variable::Type>>> _buffers;
+};
+
+#endif /* CORRECTIONADAPTER_H_ */
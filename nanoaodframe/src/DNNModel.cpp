@@ -0,0 +1,201 @@
+/*
+ * DNNModel.cpp
+ *
+ *  Batched feed-forward network inference.
+ */
+
+#include "DNNModel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+DNNModel::DNNModel(std::string filename, unsigned int nslots)
+:_work(std::max(nslots, 1u))
+{
+    if (!load(filename)) {
+        _inputs.clear();
+        _layers.clear();
+    }
+}
+
+bool DNNModel::load(std::string filename)
+{
+    std::ifstream infile(filename);
+    if (!infile.good()) {
+        cout << "ERROR! DNNModel: cannot open " << filename << endl;
+        return false;
+    }
+    // drop comments, then read token by token
+    std::stringstream text;
+    std::string line;
+    while (std::getline(infile, line)) text << line.substr(0, line.find('#')) << "\n";
+
+    auto readfloats = [&text](std::vector<float> &v, int n) {
+        v.resize(n);
+        for (int i=0; i<n; i++) text >> v[i];
+        return !text.fail();
+    };
+    auto toactivation = [](const std::string &name, Activation &act) {
+        static const std::vector<std::pair<std::string, Activation>> names = {
+            {"linear", kLinear}, {"relu", kRelu}, {"elu", kElu}, {"selu", kSelu},
+            {"sigmoid", kSigmoid}, {"tanh", kTanh}, {"softmax", kSoftmax}};
+        for (auto &n : names) {
+            if (n.first == name) {
+                act = n.second;
+                return true;
+            }
+        }
+        return false;
+    };
+
+    std::string key;
+    while (text >> key) {
+        if (key == "inputs") {
+            int n = 0;
+            text >> n;
+            _inputs.resize(std::max(n, 0));
+            for (auto &name : _inputs) text >> name;
+        } else if (key == "scaling") {
+            int n = 0;
+            text >> n;
+            if (n != ninputs() || !readfloats(_offset, n) || !readfloats(_scale, n)) {
+                cout << "ERROR! DNNModel: bad input scaling in " << filename << endl;
+                return false;
+            }
+        } else if (key == "dense" || key == "affine") {
+            layer l;
+            std::string actname;
+            l.dense = key == "dense";
+            if (l.dense) text >> l.nin >> l.nout >> actname;
+            else {
+                text >> l.nin >> actname;
+                l.nout = l.nin;
+            }
+            int nw = l.dense ? l.nin * l.nout : l.nin;
+            if (text.fail() || l.nin <= 0 || l.nout <= 0 || !toactivation(actname, l.act)
+                    || !readfloats(l.w, nw) || !readfloats(l.b, l.nout)) {
+                cout << "ERROR! DNNModel: bad " << key << " layer " << _layers.size() << " in " << filename << endl;
+                return false;
+            }
+            int nprev = _layers.empty() ? ninputs() : _layers.back().nout;
+            if (l.nin != nprev) {
+                cout << "ERROR! DNNModel: layer " << _layers.size() << " expects " << l.nin << " inputs, got " << nprev << " in " << filename << endl;
+                return false;
+            }
+            _maxwidth = std::max({_maxwidth, l.nin, l.nout});
+            _layers.push_back(std::move(l));
+        } else {
+            cout << "ERROR! DNNModel: unknown keyword " << key << " in " << filename << endl;
+            return false;
+        }
+    }
+    if (_inputs.empty() || _layers.empty()) {
+        cout << "ERROR! DNNModel: no inputs or layers in " << filename << endl;
+        return false;
+    }
+    cout << "DNNModel: loaded " << filename << " with " << ninputs() << " inputs and " << _layers.size() << " layers" << endl;
+    return true;
+}
+
+void DNNModel::activate(Activation act, float *x, int nbatch, int n)
+{
+    const int size = nbatch * n;
+    switch (act) {
+    case kLinear:
+        break;
+    case kRelu:
+        for (int i=0; i<size; i++) x[i] = std::max(x[i], 0.0f);
+        break;
+    case kElu:
+        for (int i=0; i<size; i++) x[i] = x[i] > 0 ? x[i] : std::expm1(x[i]);
+        break;
+    case kSelu: {
+        const float alpha = 1.6732632423543772f;
+        const float lambda = 1.0507009873554805f;
+        for (int i=0; i<size; i++) x[i] = lambda * (x[i] > 0 ? x[i] : alpha * std::expm1(x[i]));
+        break;
+    }
+    case kSigmoid:
+        for (int i=0; i<size; i++) x[i] = 1.0f / (1.0f + std::exp(-x[i]));
+        break;
+    case kTanh:
+        for (int i=0; i<size; i++) x[i] = std::tanh(x[i]);
+        break;
+    case kSoftmax:
+        for (int r=0; r<nbatch; r++) {
+            float *row = x + r * n;
+            float maxval = *std::max_element(row, row + n);
+            float sum = 0;
+            for (int j=0; j<n; j++) {
+                row[j] = std::exp(row[j] - maxval);
+                sum += row[j];
+            }
+            for (int j=0; j<n; j++) row[j] /= sum;
+        }
+        break;
+    }
+}
+
+const float *DNNModel::forward(unsigned int slot, const float *in, int nbatch) const
+{
+    // only this slot touches its workspace
+    std::vector<float> &work = _work[slot];
+    const size_t bufsize = size_t(nbatch) * _maxwidth;
+    if (work.size() < 2 * bufsize) work.resize(2 * bufsize);
+    float *cur = work.data();
+    float *next = work.data() + bufsize;
+
+    const int nin = ninputs();
+    std::copy(in, in + nbatch * nin, cur);
+    if (!_scale.empty()) {
+        for (int r=0; r<nbatch; r++) {
+            float *row = cur + r * nin;
+            for (int k=0; k<nin; k++) row[k] = (row[k] - _offset[k]) * _scale[k];
+        }
+    }
+
+    for (auto &l : _layers) {
+        if (l.dense) {
+            // next[r][j] = b[j] + sum_k cur[r][k] * w[k][j], j innermost over contiguous memory
+            for (int r=0; r<nbatch; r++) {
+                const float *x = cur + r * l.nin;
+                float *y = next + r * l.nout;
+                std::copy(l.b.begin(), l.b.end(), y);
+                for (int k=0; k<l.nin; k++) {
+                    const float xk = x[k];
+                    const float *wk = l.w.data() + k * l.nout;
+                    for (int j=0; j<l.nout; j++) y[j] += xk * wk[j];
+                }
+            }
+        } else {
+            for (int r=0; r<nbatch; r++) {
+                const float *x = cur + r * l.nin;
+                float *y = next + r * l.nout;
+                for (int j=0; j<l.nout; j++) y[j] = x[j] * l.w[j] + l.b[j];
+            }
+        }
+        activate(l.act, next, nbatch, l.nout);
+        std::swap(cur, next);
+    }
+    return cur;
+}
+
+void DNNModel::evaluate(unsigned int slot, const float *in, int nbatch, float *out) const
+{
+    if (!isValid() || nbatch <= 0) return;
+
+    const float *res = forward(slot, in, nbatch);
+    std::copy(res, res + nbatch * noutputs(), out);
+}
+
+float DNNModel::score(unsigned int slot, const floats &in, int node) const
+{
+    if (!isValid() || int(in.size()) != ninputs() || node < 0 || node >= noutputs()) return -1;
+
+    return forward(slot, in.data(), 1)[node];
+}
@@ -0,0 +1,68 @@
+/*
+ * DNNModel.h
+ *
+ *  Dependency free inference of the feed-forward classifiers trained in
+ *  DNN/train.py. The network is read from the text file written by
+ *  DNN/export_weights.py:
+ *
+ *    inputs  N  name_1 ... name_N        analyzer column names, in order
+ *    scaling N  offset_1 ... scale_1 ... optional, x -> (x - offset) * scale
+ *    dense   NIN NOUT activation  W[NIN][NOUT] (row-major)  b[NOUT]
+ *    affine  N activation  scale[N]  shift[N]   (e.g. folded BatchNorm)
+ *
+ *  '#' starts a comment. Activations: linear, relu, elu, selu, sigmoid,
+ *  tanh, softmax.
+ *  evaluate() runs a batch of events at once with one workspace per
+ *  RDataFrame slot, so the model can be shared between slots.
+ */
+
+#ifndef DNNMODEL_H_
+#define DNNMODEL_H_
+
+#include <string>
+#include <vector>
+
+#include "utility.h"
+
+class DNNModel {
+public:
+    DNNModel() {}
+    DNNModel(std::string filename, unsigned int nslots=1);
+
+    bool isValid() const { return !_layers.empty(); }
+    int ninputs() const { return _inputs.size(); }
+    int noutputs() const { return _layers.empty() ? 0 : _layers.back().nout; }
+    const std::vector<std::string> &inputNames() const { return _inputs; }
+
+    // in: nbatch rows of ninputs(), out: nbatch rows of noutputs()
+    void evaluate(unsigned int slot, const float *in, int nbatch, float *out) const;
+    // output node of one event
+    float score(unsigned int slot, const floats &in, int node=1) const;
+
+private:
+    enum Activation { kLinear, kRelu, kElu, kSelu, kSigmoid, kTanh, kSoftmax };
+    struct layer
+    {
+        bool dense;
+        int nin;
+        int nout;
+        Activation act;
+        std::vector<float> w;   // dense: nin x nout, affine: scale
+        std::vector<float> b;   // dense: bias, affine: shift
+    };
+
+    bool load(std::string filename);
+    // runs the network, the result points into the slot workspace
+    const float *forward(unsigned int slot, const float *in, int nbatch) const;
+    static void activate(Activation act, float *x, int nbatch, int n);
+
+    std::vector<std::string> _inputs;
+    std::vector<float> _offset;
+    std::vector<float> _scale;
+    std::vector<layer> _layers;
+    int _maxwidth = 0;
+    // two ping-pong buffers per slot, grown to the largest batch seen
+    mutable std::vector<std::vector<float>> _work;
+};
+
+#endif /* DNNMODEL_H_ */
@@ -0,0 +1,442 @@
+/*
+ * DatasetProcessor.cpp
+ *
+ *  Multi-threaded processing of a list of files into one output.
+ */
+
+#include "DatasetProcessor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <thread>
+
+#include "ColumnExport.h"
+#include "TFile.h"
+#include "TFileMerger.h"
+#include "TROOT.h"
+#include "TTree.h"
+
+using namespace std;
+
+DatasetProcessor::DatasetProcessor(std::vector<std::string> files, std::string treename)
+:_treename(treename), _ncached(0), _exported(false), _ncompressfailed(0)
+{
+    for (auto &fname : files) {
+        std::unique_ptr<TFile> f(TFile::Open(fname.c_str()));
+        if (!f || f->IsZombie()) {
+            cout << "ERROR! DatasetProcessor: cannot open " << fname << ", skipped" << endl;
+            continue;
+        }
+        TH1 *h = f->Get<TH1>("hcounter");
+        if (h != nullptr) {
+            if (_counter) _counter->Add(h);
+            else {
+                _counter.reset(static_cast<TH1 *>(h->Clone()));
+                _counter->SetDirectory(0);
+            }
+        }
+        TTree *t = f->Get<TTree>(treename.c_str());
+        if (t == nullptr || t->GetEntries() == 0) continue;
+
+        const Long64_t nentries = t->GetEntries();
+        std::vector<Long64_t> clusters;
+        auto it = t->GetClusterIterator(0);
+        for (Long64_t start = it(); start < nentries; start = it()) clusters.push_back(start);
+        clusters.push_back(nentries);
+
+        _files.push_back(fname);
+        _entries.push_back(nentries);
+        _inputids.push_back(fname + " " + f->GetUUID().AsString() + " " + std::to_string(nentries));
+        _clusters.push_back(std::move(clusters));
+        _totalentries += nentries;
+    }
+    cout << "DatasetProcessor: " << _files.size() << " of " << files.size() << " files with events, "
+         << _totalentries << " entries" << endl;
+}
+
+void DatasetProcessor::setCache(std::string dir, Long64_t rangeentries)
+{
+    _cache.reset(new ProcessingCache(dir));
+    _fixedrangeentries = rangeentries;
+    cout << "DatasetProcessor: partial outputs cached in " << dir << ", build id " << ProcessingCache::buildId() << endl;
+}
+
+void DatasetProcessor::setCheckpoint(Long64_t rangeentries)
+{
+    _checkpoint = true;
+    _fixedrangeentries = rangeentries;
+}
+
+void DatasetProcessor::setAsyncCompression(int nthreads, int compression, size_t maxpending)
+{
+    _ncompressors = std::max(0, nthreads);
+    _compression = compression;
+    _maxpending = maxpending > 0 ? maxpending : 2 * _ncompressors;
+}
+
+void DatasetProcessor::split(int nworkers, int rangesperworker, Long64_t minentries)
+{
+    _ranges.clear();
+    Long64_t target = std::max(minentries, _totalentries / std::max(1, nworkers * rangesperworker));
+    // the ranges of a file must not depend on the other files or the workers, to be found again in the cache or the manifest
+    if (_fixedrangeentries > 0) target = _fixedrangeentries;
+    for (size_t f=0; f<_files.size(); f++) {
+        const std::vector<Long64_t> &c = _clusters[f];
+        Long64_t begin = 0;
+        for (size_t i=1; i<c.size(); i++) {
+            // close the range at a cluster boundary once it is large enough,
+            // or merge a small remainder into the last range of the file
+            bool last = i == c.size()-1;
+            if ((c[i] - begin >= target && _entries[f] - c[i] >= target / 2) || last) {
+                _ranges.push_back({int(f), begin, c[i]});
+                begin = c[i];
+            }
+        }
+    }
+    cout << "DatasetProcessor: " << _ranges.size() << " ranges of about " << target << " entries" << endl;
+}
+
+std::string DatasetProcessor::partName(size_t idx) const
+{
+    std::string name = _outfilename;
+    name.replace(name.rfind(".root"), 5, "_part" + std::to_string(idx) + ".root");
+    return name;
+}
+
+std::string DatasetProcessor::exportDir(const std::string &filename)
+{
+    std::string name = filename;
+    name.replace(name.rfind(".root"), 5, "_columns");
+    return name;
+}
+
+std::string DatasetProcessor::rawPartName(size_t idx) const
+{
+    std::string name = partName(idx);
+    name.replace(name.rfind(".root"), 5, "_raw.root");
+    // local scratch of the batch job rather than the output directory
+    const char *tmpdir = std::getenv("TMPDIR");
+    if (tmpdir != nullptr && *tmpdir != '\0') name = std::string(tmpdir) + "/" + name.substr(name.rfind('/') + 1);
+    return name;
+}
+
+bool DatasetProcessor::nextRange(int worker, size_t &idx)
+{
+    {
+        std::lock_guard<std::mutex> lock(*_locks[worker]);
+        if (!_queues[worker].empty()) {
+            idx = _queues[worker].front();
+            _queues[worker].pop_front();
+            return true;
+        }
+    }
+    // steal the smallest range of the fullest deque
+    while (true) {
+        int victim = -1;
+        size_t most = 0;
+        for (size_t w=0; w<_queues.size(); w++) {
+            std::lock_guard<std::mutex> lock(*_locks[w]);
+            if (_queues[w].size() > most) {
+                most = _queues[w].size();
+                victim = w;
+            }
+        }
+        if (victim < 0) return false;
+        std::lock_guard<std::mutex> lock(*_locks[victim]);
+        if (_queues[victim].empty()) continue;
+        idx = _queues[victim].back();
+        _queues[victim].pop_back();
+        return true;
+    }
+}
+
+std::string DatasetProcessor::rangeLine(size_t idx) const
+{
+    const entryrange &r = _ranges[idx];
+    std::ostringstream line;
+    line << "range " << idx << " " << _inputids[r.fileidx] << " " << r.begin << " " << r.end;
+    return line.str();
+}
+
+std::vector<bool> DatasetProcessor::readManifest()
+{
+    const std::string manifestname = _outfilename + ".manifest";
+    std::vector<bool> done(_ranges.size(), false);
+    std::ifstream in(manifestname);
+    std::string line;
+    // the configuration, the ranges, then one "done <idx>" line per finished range
+    bool sameconfiguration = in.good() && std::getline(in, line) && line == _manifestheader;
+    bool matches = sameconfiguration;
+    for (size_t i=0; matches && i<_ranges.size(); i++) {
+        matches = std::getline(in, line) && line == rangeLine(i);
+    }
+    if (matches) {
+        size_t ndone = 0;
+        while (std::getline(in, line)) {
+            std::istringstream words(line);
+            std::string word;
+            size_t idx;
+            if (!(words >> word >> idx) || word != "done" || idx >= _ranges.size()) continue;
+            // a part without its done line was interrupted and is processed again
+            std::ifstream part(partName(idx));
+            if (part.good() && !done[idx]) {
+                done[idx] = true;
+                ndone++;
+            }
+        }
+        cout << "DatasetProcessor: resuming from " << manifestname << ", " << ndone << " of " << _ranges.size() << " ranges done" << endl;
+        in.close();
+        _manifest.open(manifestname, std::ios::app);
+    } else {
+        if (!sameconfiguration && std::ifstream(manifestname).good()) {
+            cout << "WARNING! DatasetProcessor: " << manifestname << " was written with other options or another build, starting over" << endl;
+        } else if (sameconfiguration) {
+            cout << "WARNING! DatasetProcessor: " << manifestname << " does not match the inputs, starting over" << endl;
+        }
+        in.close();
+        _manifest.open(manifestname, std::ios::trunc);
+        _manifest << _manifestheader << "\n";
+        for (size_t i=0; i<_ranges.size(); i++) _manifest << rangeLine(i) << "\n";
+        _manifest.flush();
+    }
+    if (!_manifest.good()) cout << "WARNING! DatasetProcessor: cannot write " << manifestname << ", the job cannot be resumed" << endl;
+    return done;
+}
+
+void DatasetProcessor::markDone(size_t idx)
+{
+    // the part is closed when the analyzer returns, so it is complete once its line is in the manifest
+    std::lock_guard<std::mutex> lock(_manifestlock);
+    _manifest << "done " << idx << endl;
+}
+
+void DatasetProcessor::enqueueCompression(size_t idx, const std::string &key)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(_compresslock);
+    _compresscv.wait(lock, [this]() { return _compressqueue.size() < _maxpending; });
+    _waitseconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    _compressqueue.push_back({idx, key});
+    _compresscv.notify_all();
+}
+
+bool DatasetProcessor::compressPart(size_t idx)
+{
+    auto start = std::chrono::steady_clock::now();
+    // a one input merge with the slow method decompresses and rewrites every basket
+    TFileMerger merger(false, false);
+    merger.SetPrintLevel(0);
+    merger.SetFastMethod(false);
+    bool ok = merger.OutputFile(partName(idx).c_str(), "RECREATE", _compression)
+              && merger.AddFile(rawPartName(idx).c_str(), false) && merger.Merge();
+    std::remove(rawPartName(idx).c_str());
+    if (!ok) {
+        cout << "ERROR! DatasetProcessor: cannot compress " << rawPartName(idx) << " into " << partName(idx) << endl;
+        std::remove(partName(idx).c_str());
+    }
+    std::lock_guard<std::mutex> lock(_compresslock);
+    _compressseconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return ok;
+}
+
+void DatasetProcessor::compressParts()
+{
+    while (true) {
+        std::pair<size_t, std::string> item;
+        {
+            std::unique_lock<std::mutex> lock(_compresslock);
+            _compresscv.wait(lock, [this]() { return !_compressqueue.empty() || _compressclosed; });
+            if (_compressqueue.empty()) return;
+            item = _compressqueue.front();
+            _compressqueue.pop_front();
+            _compresscv.notify_all();
+        }
+        if (!compressPart(item.first)) {
+            _ncompressfailed++;
+            continue;
+        }
+        // only the compressed part goes to the cache and counts as done
+        if (_cache && !_exported) _cache->store(item.second, partName(item.first));
+        if (_checkpoint) markDone(item.first);
+    }
+}
+
+std::string DatasetProcessor::graphId(const NanoAODAnalyzerrdframe &analyzer, TTree *t)
+{
+    std::vector<std::string> branches;
+    TObjArray *all = t->GetListOfBranches();
+    for (int i=0; i<all->GetEntriesFast(); i++) branches.push_back(all->At(i)->GetName());
+    std::sort(branches.begin(), branches.end());
+    std::string text = analyzer.configurationSummary() + "\nbranches";
+    for (auto &b : branches) text += " " + b;
+    return ProcessingCache::hash(text);
+}
+
+bool DatasetProcessor::processRange(AnalyzerFactory &factory, size_t idx, bool saveAll, const std::string &outtreename)
+{
+    const entryrange &r = _ranges[idx];
+    const std::string &fname = _files[r.fileidx];
+    std::unique_ptr<TFile> f(TFile::Open(fname.c_str()));
+    TTree *t = (f && !f->IsZombie()) ? f->Get<TTree>(_treename.c_str()) : nullptr;
+    if (t == nullptr) {
+        cout << "ERROR! DatasetProcessor: cannot read " << _treename << " from " << fname << endl;
+        return false;
+    }
+    cout << "DatasetProcessor: entries [" << r.begin << ", " << r.end << ") of " << fname << endl;
+
+    auto analyzer = factory(t, _ncompressors > 0 ? rawPartName(idx) : partName(idx));
+    if (!analyzer) return false;
+    if (_ncompressors > 0) analyzer->setOutputCompression(0);
+    if (!analyzer->exportedColumns().empty()) {
+        analyzer->setColumnExport(analyzer->exportedColumns(), exportDir(partName(idx)));
+        _exported = true;
+    }
+    if (r.begin != 0 || r.end != _entries[r.fileidx]) analyzer->setEntryRange(r.begin, r.end);
+    analyzer->setupAnalysis();
+
+    std::string key = "";
+    // the cache holds the output file only; setupAnalysis reads no events, so a cached range reads none
+    if (_cache && !_exported) {
+        std::ostringstream inputid;
+        inputid << _inputids[r.fileidx] << " [" << r.begin << ", " << r.end << ") " << outtreename << " " << saveAll;
+        key = _cache->key(inputid.str(), analyzer->configurationSummary());
+        if (_cache->fetch(key, partName(idx))) {
+            cout << "DatasetProcessor: entries [" << r.begin << ", " << r.end << ") of " << fname << " taken from the cache (" << key << ")" << endl;
+            _ncached++;
+            // the worker leaves the done line to the compression threads
+            if (_checkpoint && _ncompressors > 0) markDone(idx);
+            return true;
+        }
+    }
+    // a branch list is only reused by a range with the same graph, another graph may need branches missing from it
+    const std::string graph = graphId(*analyzer, t);
+    {
+        std::lock_guard<std::mutex> lock(_inputbrancheslock);
+        auto learned = _inputbranches.find(graph);
+        if (learned != _inputbranches.end()) analyzer->setInputBranches(learned->second);
+    }
+    analyzer->run(saveAll, outtreename);
+    {
+        std::lock_guard<std::mutex> lock(_inputbrancheslock);
+        if (_inputbranches.count(graph) == 0 && !analyzer->inputBranches().empty()) _inputbranches[graph] = analyzer->inputBranches();
+    }
+    if (_ncompressors > 0) enqueueCompression(idx, key);
+    else if (_cache && !_exported) _cache->store(key, partName(idx));
+    return true;
+}
+
+bool DatasetProcessor::run(AnalyzerFactory factory, std::string outfilename, int nworkers, bool saveAll, std::string outtreename)
+{
+    _outfilename = outfilename;
+    if (_ranges.empty()) split(nworkers);
+    if (_ranges.empty()) {
+        cout << "There is NO EVENT to process, ending the processing!!" << endl;
+        return false;
+    }
+    std::vector<bool> done(_ranges.size(), false);
+    std::ostringstream configuration;
+    configuration << _jobconfiguration << "\ntree " << outtreename << " " << saveAll << "\nbuild " << ProcessingCache::buildId();
+    _manifestheader = "configuration " + ProcessingCache::hash(configuration.str());
+    if (_checkpoint) done = readManifest();
+
+    // deal the ranges largest first, round robin
+    std::vector<size_t> order;
+    for (size_t i=0; i<_ranges.size(); i++) {
+        if (!done[i]) order.push_back(i);
+    }
+    nworkers = std::max(1, std::min<int>(nworkers, order.size()));
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return _ranges[a].end - _ranges[a].begin > _ranges[b].end - _ranges[b].begin;
+    });
+    _queues.assign(nworkers, std::deque<size_t>());
+    _locks.clear();
+    for (int w=0; w<nworkers; w++) _locks.emplace_back(new std::mutex);
+    for (size_t i=0; i<order.size(); i++) _queues[i % nworkers].push_back(order[i]);
+
+    // the analyzers are single threaded, the workers provide the parallelism
+    ROOT::EnableThreadSafety();
+    auto start = std::chrono::steady_clock::now();
+    _compressclosed = false;
+    std::vector<std::thread> compressors;
+    for (int c=0; c<_ncompressors; c++) compressors.emplace_back(&DatasetProcessor::compressParts, this);
+    std::atomic<int> nfailed(0);
+    std::vector<std::thread> workers;
+    for (int w=0; w<nworkers; w++) {
+        workers.emplace_back([&, w]() {
+            size_t idx;
+            while (nextRange(w, idx)) {
+                if (!processRange(factory, idx, saveAll, outtreename)) nfailed++;
+                else if (_checkpoint && _ncompressors == 0) markDone(idx);
+            }
+        });
+    }
+    for (auto &w : workers) w.join();
+    {
+        std::lock_guard<std::mutex> lock(_compresslock);
+        _compressclosed = true;
+    }
+    _compresscv.notify_all();
+    for (auto &c : compressors) c.join();
+    nfailed += _ncompressfailed;
+
+    Long64_t nprocessed = 0;
+    for (size_t i : order) nprocessed += _ranges[i].end - _ranges[i].begin;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    cout << "DatasetProcessor: " << nprocessed << " entries in " << seconds << " s, "
+         << (seconds > 0 ? nprocessed / seconds : 0) << " entries/s with " << nworkers << " workers" << endl;
+    if (_ncompressors > 0) {
+        cout << "DatasetProcessor: " << _ncompressors << " compression threads busy " << _compressseconds
+             << " s, workers waited " << _waitseconds << " s for the queue" << endl;
+    }
+
+    if (_cache) cout << "DatasetProcessor: " << _ncached << " of " << _ranges.size() << " ranges taken from the cache" << endl;
+    if (nfailed > 0) {
+        cout << "ERROR! DatasetProcessor: " << nfailed << " of " << _ranges.size() << " ranges failed, "
+             << outfilename << " not written" << endl;
+        if (_checkpoint) cout << "The finished ranges are kept, rerun the job to process the others" << endl;
+        return false;
+    }
+
+    // parts in input order, so the output tree keeps the order of the inputs
+    TFileMerger merger(false);
+    merger.SetPrintLevel(0);
+    if (!merger.OutputFile(outfilename.c_str(), "RECREATE")) {
+        cout << "ERROR! DatasetProcessor: cannot create " << outfilename << endl;
+        return false;
+    }
+    for (size_t i=0; i<_ranges.size(); i++) merger.AddFile(partName(i).c_str(), false);
+    bool ok = merger.Merge();
+    // column exports of the parts, in the same order as the trees
+    std::vector<std::string> exportdirs;
+    if (std::ifstream(exportDir(partName(0)) + "/schema.json").good()) {
+        for (size_t i=0; i<_ranges.size(); i++) exportdirs.push_back(exportDir(partName(i)));
+        ok = ok && ColumnExport::concatenate(exportdirs, exportDir(outfilename));
+    }
+    // with checkpoints a failed merge is retried from the parts by the next attempt
+    if (ok || !_checkpoint) {
+        for (size_t i=0; i<_ranges.size(); i++) std::remove(partName(i).c_str());
+        for (auto &dir : exportdirs) ColumnExport::remove(dir);
+    }
+    if (!ok) {
+        cout << "ERROR! DatasetProcessor: merging into " << outfilename << " failed" << endl;
+        return false;
+    }
+
+    if (_counter) {
+        cout << "Updating with counter histogram" << endl;
+        TFile outf(outfilename.c_str(), "UPDATE");
+        _counter->Write("", TObject::kOverwrite);
+        outf.Close();
+    }
+    if (_checkpoint) {
+        _manifest.close();
+        std::remove((outfilename + ".manifest").c_str());
+    }
+    return true;
+}
@@ -0,0 +1,158 @@
+/*
+ * DatasetProcessor.h
+ *
+ *  Runs an analyzer over a whole dataset (list of files) with several
+ *  worker threads and writes one output file:
+ *   - every input is opened once to read its number of entries, its
+ *     cluster boundaries and its counter histogram (hcounter)
+ *   - the files are cut into entry ranges made of whole clusters, so large
+ *     files are shared between workers and small files are not split
+ *   - every worker has its own deque of ranges, largest first, and steals
+ *     from the back of the fullest deque when its own is empty
+ *   - every range is processed by its own single threaded analyzer into a
+ *     part file; the parts are merged in-process with TFileMerger, in input
+ *     order, and the summed counter histogram is added
+ *  With a ProcessingCache the part of every range is looked up before it is
+ *  processed and stored after, so a rerun only processes new or changed
+ *  inputs and configurations.
+ *  The input branches read by the first finished range are passed to the
+ *  analyzers of the later ranges that build the same graph (same
+ *  configurationSummary and same input branches), which then read only
+ *  those (TTreeCache prefilled with them, other branches disabled); the
+ *  other ranges read all branches until one of their kind has finished.
+ *  In checkpoint mode the parts are kept until the merge, and every finished
+ *  range is appended to <output>.manifest; a restarted job skips the ranges
+ *  of the manifest and merges the same parts as an uninterrupted run. The
+ *  manifest starts with a hash of the job configuration, the output tree
+ *  and the build id, and a job with another hash starts over.
+ *  With asynchronous compression the analyzers write their parts
+ *  uncompressed and hand them to a bounded queue; a pool of compression
+ *  threads rewrites them compressed while the workers go on with the next
+ *  ranges. A worker waits when the queue is full, so at most maxpending
+ *  uncompressed parts are on disk.
+ *  The column exports of the parts (setColumnExport of the analyzers) are
+ *  concatenated in input order next to the output.
+ */
+
+#ifndef DATASETPROCESSOR_H_
+#define DATASETPROCESSOR_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "TH1.h"
+#include "NanoAODAnalyzerrdframe.h"
+#include "ProcessingCache.h"
+
+struct entryrange
+{
+    int fileidx;
+    Long64_t begin;
+    Long64_t end;
+};
+
+class DatasetProcessor {
+public:
+    // builds a configured (not yet set up) analyzer reading t and writing outfilename
+    using AnalyzerFactory = std::function<std::unique_ptr<NanoAODAnalyzerrdframe>(TTree *t, std::string outfilename)>;
+
+    DatasetProcessor(std::vector<std::string> files, std::string treename="Events");
+
+    // reuse and store partial outputs; ranges are then cut with a fixed size, independent of the number of workers
+    void setCache(std::string dir, Long64_t rangeentries=500000);
+    // resume from <output>.manifest, ranges of a fixed size as for the cache
+    void setCheckpoint(Long64_t rangeentries=500000);
+    // the job options that change the output (syst, JSON, ...): a manifest written with others is not resumed
+    void setJobConfiguration(std::string configuration) { _jobconfiguration = configuration; }
+    // compress the parts in nthreads separate threads (compression settings as TFile, algorithm*100 + level),
+    // at most maxpending uncompressed parts waiting (0: 2*nthreads)
+    void setAsyncCompression(int nthreads, int compression=101, size_t maxpending=0);
+
+    // cut the files into ranges of about totalentries / (nworkers * rangesperworker) entries, at least minentries
+    void split(int nworkers, int rangesperworker=4, Long64_t minentries=10000);
+    const std::vector<entryrange> &ranges() const { return _ranges; }
+    Long64_t entries() const { return _totalentries; }
+
+    // false if any range failed, the output is then not written
+    bool run(AnalyzerFactory factory, std::string outfilename, int nworkers, bool saveAll=false, std::string outtreename="Events");
+
+private:
+    bool processRange(AnalyzerFactory &factory, size_t idx, bool saveAll, const std::string &outtreename);
+    std::string partName(size_t idx) const;
+    // <name>_columns for <name>.root
+    static std::string exportDir(const std::string &filename);
+    // uncompressed part, in $TMPDIR if set
+    std::string rawPartName(size_t idx) const;
+    // blocks while the compression queue is full
+    void enqueueCompression(size_t idx, const std::string &key);
+    // compression thread: rewrites the queued parts until the queue is closed
+    void compressParts();
+    bool compressPart(size_t idx);
+    // own deque first, then steal
+    bool nextRange(int worker, size_t &idx);
+    // ranges already done by a previous attempt, starts a new manifest if it does not match the ranges
+    std::vector<bool> readManifest();
+    void markDone(size_t idx);
+    std::string rangeLine(size_t idx) const;
+    // hash of the configuration of a set up analyzer and of the branches of its input tree,
+    // the graph depends on both (isDefined)
+    static std::string graphId(const NanoAODAnalyzerrdframe &analyzer, TTree *t);
+
+    std::string _treename;
+    std::vector<std::string> _files;
+    std::vector<Long64_t> _entries;
+    // path, UUID and entries of every file
+    std::vector<std::string> _inputids;
+    // cluster start entries of every file, followed by its number of entries
+    std::vector<std::vector<Long64_t>> _clusters;
+    Long64_t _totalentries = 0;
+    std::unique_ptr<TH1> _counter;
+
+    std::vector<entryrange> _ranges;
+    std::string _outfilename;
+
+    std::unique_ptr<ProcessingCache> _cache;
+    // range size with a cache or checkpoints, 0 to adapt it to the number of workers
+    Long64_t _fixedrangeentries = 0;
+    std::atomic<int> _ncached;
+    // the analyzers export columns, which are not cached
+    std::atomic<bool> _exported;
+
+    // input branches of the graph, from the first finished range of every graph (see graphId)
+    std::map<std::string, std::vector<std::string>> _inputbranches;
+    std::mutex _inputbrancheslock;
+
+    bool _checkpoint = false;
+    std::string _jobconfiguration;
+    // first line of the manifest
+    std::string _manifestheader;
+    std::ofstream _manifest;
+    std::mutex _manifestlock;
+
+    int _ncompressors = 0;
+    int _compression = 101;
+    size_t _maxpending = 0;
+    // range index and cache key of the uncompressed parts
+    std::deque<std::pair<size_t, std::string>> _compressqueue;
+    bool _compressclosed = false;
+    std::mutex _compresslock;
+    std::condition_variable _compresscv;
+    std::atomic<int> _ncompressfailed;
+    // time the workers waited for the queue and the compression threads spent compressing
+    double _waitseconds = 0;
+    double _compressseconds = 0;
+
+    // per worker deques of range indices
+    std::vector<std::deque<size_t>> _queues;
+    std::vector<std::unique_ptr<std::mutex>> _locks;
+};
+
+#endif /* DATASETPROCESSOR_H_ */
@@ -0,0 +1,191 @@
+/*
+ * EraPolicy.h
+ *
+ *  Compile-time description of the Run 2 UL data-taking eras.
+ *  Era dependent constants (XY MET corrections, HEM region) live in constexpr
+ *  tables; the analyzer picks the era once in its constructor and the
+ *  kernels that need them are instantiated per (era, data/MC) with
+ *  dispatchEra, so no year string or run-range chain is evaluated per event.
+ */
+
+#ifndef ERAPOLICY_H_
+#define ERAPOLICY_H_
+
+#include <array>
+#include <string>
+
+enum class Era { Run2016pre, Run2016post, Run2017, Run2018, Unknown };
+
+// XY MET correction: corr = -(slope * npv + offset)
+// https://lathomas.web.cern.ch/lathomas/METStuff/XYCorrections/XYMETCorrection_withUL17andUL18andUL16.h
+struct metxycoef
+{
+    double xslope;
+    double xoffset;
+    double yslope;
+    double yoffset;
+};
+
+// data coefficients for runs in [runmin, runmax] (or run == runextra)
+struct metxyrunrange
+{
+    int runmin;
+    int runmax;
+    int runextra;
+    metxycoef coef;
+};
+
+struct hemregion
+{
+    double phimin;
+    double phimax;
+    double etamin;
+    double etamax;
+    float sf;
+};
+
+inline constexpr std::array<metxyrunrange, 8> metxyData2016 = {{
+    {272007, 275376, -1, {-0.0214894, -0.188255, 0.0876624, 0.812885}},
+    {275657, 276283, -1, {-0.032209, 0.067288, 0.113917, 0.743906}},
+    {276315, 276811, -1, {-0.0293663, 0.21106, 0.11331, 0.815787}},
+    {276831, 277420, -1, {-0.0132046, 0.20073, 0.134809, 0.679068}},
+    {277772, 278768, 278770, {-0.0543566, 0.816597, 0.114225, 1.17266}},
+    {278801, 278808, 278769, {0.134616, -0.89965, 0.0397736, 1.0385}},
+    {278820, 280385, -1, {0.121809, -0.584893, 0.0558974, 0.891234}},
+    {280919, 284044, -1, {0.0868828, -0.703489, 0.0888774, 0.902632}}
+}};
+
+inline constexpr std::array<metxyrunrange, 5> metxyData2017 = {{
+    {297020, 299329, -1, {-0.211161, 0.419333, 0.251789, -1.28089}},
+    {299337, 302029, -1, {-0.185184, -0.164009, 0.200941, -0.56853}},
+    {302030, 303434, -1, {-0.201606, 0.426502, 0.188208, -0.58313}},
+    {303435, 304826, -1, {-0.162472, 0.176329, 0.138076, -0.250239}},
+    {304911, 306462, -1, {-0.210639, 0.72934, 0.198626, 1.028}}
+}};
+
+inline constexpr std::array<metxyrunrange, 4> metxyData2018 = {{
+    {315252, 316995, -1, {0.263733, -1.91115, 0.0431304, -0.112043}},
+    {316998, 319312, -1, {0.400466, -3.05914, 0.146125, -0.533233}},
+    {319313, 320393, -1, {0.430911, -1.42865, 0.0620083, -1.46021}},
+    {320394, 325273, -1, {0.457327, -1.56856, 0.0684071, -0.928372}}
+}};
+
+template <size_t N, size_t M>
+constexpr std::array<metxyrunrange, N+M> joinRunRanges(const std::array<metxyrunrange, N> &a, const std::array<metxyrunrange, M> &b)
+{
+    std::array<metxyrunrange, N+M> out{};
+    for (size_t i=0; i<N; i++) out[i] = a[i];
+    for (size_t i=0; i<M; i++) out[N+i] = b[i];
+    return out;
+}
+
+struct Era2016pre
+{
+    static constexpr Era era = Era::Run2016pre;
+    static constexpr bool hasHEM = false;
+    static constexpr metxycoef metxyMC = {-0.153497, -0.231751, 0.00731978, 0.243323};
+    static constexpr const std::array<metxyrunrange, 8> &metxyData = metxyData2016;
+};
+
+struct Era2016post
+{
+    static constexpr Era era = Era::Run2016post;
+    static constexpr bool hasHEM = false;
+    static constexpr metxycoef metxyMC = {-0.188743, 0.136539, 0.0127927, 0.117747};
+    static constexpr const std::array<metxyrunrange, 8> &metxyData = metxyData2016;
+};
+
+struct Era2017
+{
+    static constexpr Era era = Era::Run2017;
+    static constexpr bool hasHEM = false;
+    static constexpr metxycoef metxyMC = {-0.300155, 1.90608, 0.300213, -2.02232};
+    static constexpr const std::array<metxyrunrange, 5> &metxyData = metxyData2017;
+};
+
+struct Era2018
+{
+    static constexpr Era era = Era::Run2018;
+    static constexpr bool hasHEM = true;
+    // HEM 15/16 failure: jets in this region get an extra 0.8 variation
+    static constexpr hemregion hem = {-1.57, -0.87, -2.5, -1.3, 0.8};
+    static constexpr metxycoef metxyMC = {0.183518, 0.546754, 0.192263, -0.42121};
+    static constexpr const std::array<metxyrunrange, 4> &metxyData = metxyData2018;
+};
+
+// no era given: no MC or HEM corrections, data are XY MET corrected from
+// the run number alone, with the run ranges of all eras (they do not overlap)
+struct EraUnknown
+{
+    static constexpr Era era = Era::Unknown;
+    static constexpr bool hasHEM = false;
+    static constexpr metxycoef metxyMC = {0., 0., 0., 0.};
+    static constexpr std::array<metxyrunrange, 17> metxyData = joinRunRanges(joinRunRanges(metxyData2018, metxyData2017), metxyData2016);
+};
+
+template <typename EraT, bool IsData>
+struct EraPolicy
+{
+    using era_type = EraT;
+    static constexpr bool isData = IsData;
+
+    // npv is expected to be capped at 100 already
+    static void metXYCorrection(int npv, int run, double &xcorr, double &ycorr)
+    {
+        xcorr = 0.;
+        ycorr = 0.;
+        if constexpr (!IsData) {
+            xcorr = -(EraT::metxyMC.xslope * npv + EraT::metxyMC.xoffset);
+            ycorr = -(EraT::metxyMC.yslope * npv + EraT::metxyMC.yoffset);
+        } else {
+            for (const metxyrunrange &r : EraT::metxyData) {
+                if ((run >= r.runmin && run <= r.runmax) || run == r.runextra) {
+                    xcorr = -(r.coef.xslope * npv + r.coef.xoffset);
+                    ycorr = -(r.coef.yslope * npv + r.coef.yoffset);
+                    return;
+                }
+            }
+        }
+    }
+};
+
+// top pt reweighting, LO to NLO (pt bins in GeV, one SF per bin)
+struct TopPtLOtoNLO
+{
+    static constexpr std::array<float, 16> xbins = {0,50,100,150,200,250,300,350,400,450,500,550,600,800,1000,2000};
+    static constexpr std::array<float, 15> sfs = {1.1536, 1.0578, 0.993, 0.9373, 0.8881, 0.8456, 0.8087, 0.7809, 0.7559, 0.7388, 0.7247, 0.7245, 0.7124, 0.7284, 0.7317};
+};
+
+inline Era eraFromYear(const std::string &year)
+{
+    if (year.find("2016pre") != std::string::npos) return Era::Run2016pre;
+    if (year.find("2016post") != std::string::npos) return Era::Run2016post;
+    if (year.find("2017") != std::string::npos) return Era::Run2017;
+    if (year.find("2018") != std::string::npos) return Era::Run2018;
+    return Era::Unknown;
+}
+
+// calls f(EraPolicy<era, isData>()) for the run-time era/data flags
+template <typename F>
+void dispatchEra(Era era, bool isData, F &&f)
+{
+    switch (era) {
+    case Era::Run2016pre:
+        if (isData) f(EraPolicy<Era2016pre, true>()); else f(EraPolicy<Era2016pre, false>());
+        break;
+    case Era::Run2016post:
+        if (isData) f(EraPolicy<Era2016post, true>()); else f(EraPolicy<Era2016post, false>());
+        break;
+    case Era::Run2017:
+        if (isData) f(EraPolicy<Era2017, true>()); else f(EraPolicy<Era2017, false>());
+        break;
+    case Era::Run2018:
+        if (isData) f(EraPolicy<Era2018, true>()); else f(EraPolicy<Era2018, false>());
+        break;
+    default:
+        if (isData) f(EraPolicy<EraUnknown, true>()); else f(EraPolicy<EraUnknown, false>());
+        break;
+    }
+}
+
+#endif /* ERAPOLICY_H_ */
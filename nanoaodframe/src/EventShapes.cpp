@@ -0,0 +1,223 @@
+/*
+ * EventShapes.cpp
+ *
+ *  Allocation free event shape variables.
+ */
+
+#include "EventShapes.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const int nhardest = 8;     // objects used to seed the iterative thrust axis search (JETSET MSTU(44) is 4)
+const int maxexact = 12;    // up to this many objects the axes are found by trying all sign combinations
+const int maxiter = 50;
+const double conv = 1e-4;   // convergence on the normalized thrust (JETSET PARU(48))
+
+// calls f(px, py, pz) for every object of the collections
+template <typename F>
+void forEachObject(const ObjectCollection *const *colls, int ncolls, F &&f)
+{
+    for (int c=0; c<ncolls; c++) {
+        const floats &px = colls[c]->px();
+        const floats &py = colls[c]->py();
+        const floats &pz = colls[c]->pz();
+        for (size_t i=0; i<px.size(); i++) f(double(px[i]), double(py[i]), double(pz[i]));
+    }
+}
+
+// momentum component orthogonal to the unit vector perp (if given)
+inline void project(double v[3], const double *perp)
+{
+    if (perp == nullptr) return;
+    double d = v[0]*perp[0] + v[1]*perp[1] + v[2]*perp[2];
+    for (int k=0; k<3; k++) v[k] -= d * perp[k];
+}
+
+// sum_i |p_i . n|
+double sumAbsProjection(const ObjectCollection *const *colls, int ncolls, const double n[3])
+{
+    double sum = 0.0;
+    forEachObject(colls, ncolls, [&](double x, double y, double z) {
+        sum += std::fabs(x*n[0] + y*n[1] + z*n[2]);
+    });
+    return sum;
+}
+
+// max_n sum_i |v_i . n| = max over the signs s_i of |sum_i s_i v_i|, exact; the axis is along the best sum
+void exactThrustAxis(const double v[][3], int n, double axis[3])
+{
+    double best = -1.0;
+    for (int comb=0; comb < (1 << (n-1)); comb++) {
+        double s[3] = {v[0][0], v[0][1], v[0][2]};
+        for (int k=1; k<n; k++) {
+            double sgn = ((comb >> (k-1)) & 1) ? -1.0 : 1.0;
+            for (int j=0; j<3; j++) s[j] += sgn * v[k][j];
+        }
+        double norm2 = s[0]*s[0] + s[1]*s[1] + s[2]*s[2];
+        if (norm2 > best) {
+            best = norm2;
+            double norm = std::sqrt(norm2);
+            for (int j=0; j<3; j++) axis[j] = norm > 0.0 ? s[j] / norm : 0.0;
+        }
+    }
+}
+
+// unit axis n (orthogonal to perp, if given) maximizing sum_i |p_i . n|
+// exact for up to maxexact objects, otherwise iterates n -> sum_i sign(p_i . n) p_i from every
+// sign combination of the hardest objects, which can end on a local maximum
+void findThrustAxis(const ObjectCollection *const *colls, int ncolls, double sump, const double *perp, double axis[3])
+{
+    double all[maxexact][3];
+    int nall = 0;
+    forEachObject(colls, ncolls, [&](double x, double y, double z) {
+        if (nall < maxexact) {
+            all[nall][0] = x;
+            all[nall][1] = y;
+            all[nall][2] = z;
+            project(all[nall], perp);
+        }
+        nall++;
+    });
+    if (nall <= maxexact) {
+        exactThrustAxis(all, nall, axis);
+        return;
+    }
+
+    double hard[nhardest][3];
+    double hardmag[nhardest];
+    int nhard = 0;
+    forEachObject(colls, ncolls, [&](double x, double y, double z) {
+        double v[3] = {x, y, z};
+        project(v, perp);
+        double mag = std::sqrt(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
+        int pos = nhard < nhardest ? nhard++ : nhardest;
+        while (pos > 0 && hardmag[pos-1] < mag) {
+            if (pos < nhardest) {
+                hardmag[pos] = hardmag[pos-1];
+                std::copy(hard[pos-1], hard[pos-1]+3, hard[pos]);
+            }
+            pos--;
+        }
+        if (pos < nhardest) {
+            hardmag[pos] = mag;
+            std::copy(v, v+3, hard[pos]);
+        }
+    });
+
+    axis[0] = 0.0;
+    axis[1] = 0.0;
+    axis[2] = 0.0;
+    double best = -1.0;
+    for (int comb=0; comb < (1 << std::max(nhard-1, 0)); comb++) {
+        double n[3] = {0.0, 0.0, 0.0};
+        for (int k=0; k<nhard; k++) {
+            double sgn = (k > 0 && ((comb >> (k-1)) & 1)) ? -1.0 : 1.0;
+            for (int j=0; j<3; j++) n[j] += sgn * hard[k][j];
+        }
+        double norm = std::sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+        if (norm <= 0.0) continue;
+        for (int j=0; j<3; j++) n[j] /= norm;
+
+        double value = -1.0;
+        for (int iter=0; iter<maxiter; iter++) {
+            double s[3] = {0.0, 0.0, 0.0};
+            forEachObject(colls, ncolls, [&](double x, double y, double z) {
+                double v[3] = {x, y, z};
+                project(v, perp);
+                double sgn = (v[0]*n[0] + v[1]*n[1] + v[2]*n[2]) >= 0.0 ? 1.0 : -1.0;
+                for (int j=0; j<3; j++) s[j] += sgn * v[j];
+            });
+            double snorm = std::sqrt(s[0]*s[0] + s[1]*s[1] + s[2]*s[2]);
+            if (snorm <= 0.0) break;
+            for (int j=0; j<3; j++) n[j] = s[j] / snorm;
+            bool converged = snorm <= value + conv * sump;
+            value = std::max(value, snorm);
+            if (converged) break;
+        }
+        if (value > best) {
+            best = value;
+            std::copy(n, n+3, axis);
+        }
+    }
+}
+
+} // namespace
+
+void symEigenvalues3(const double m[6], double lambda[3])
+{
+    // trigonometric solution of the characteristic polynomial (O.K. Smith, 1961)
+    const double xx = m[0], yy = m[1], zz = m[2], xy = m[3], xz = m[4], yz = m[5];
+    const double p1 = xy*xy + xz*xz + yz*yz;
+    if (p1 <= 0.0) {
+        lambda[0] = xx;
+        lambda[1] = yy;
+        lambda[2] = zz;
+    } else {
+        const double q = (xx + yy + zz) / 3.0;
+        const double p2 = (xx-q)*(xx-q) + (yy-q)*(yy-q) + (zz-q)*(zz-q) + 2.0*p1;
+        const double p = std::sqrt(p2 / 6.0);
+        // B = (A - qI) / p, r = det(B) / 2
+        const double bxx = (xx-q)/p, byy = (yy-q)/p, bzz = (zz-q)/p;
+        const double bxy = xy/p, bxz = xz/p, byz = yz/p;
+        double r = 0.5 * (bxx*(byy*bzz - byz*byz) - bxy*(bxy*bzz - byz*bxz) + bxz*(bxy*byz - byy*bxz));
+        r = std::max(-1.0, std::min(1.0, r));
+        const double phi = std::acos(r) / 3.0;
+        lambda[0] = q + 2.0*p*std::cos(phi);
+        lambda[2] = q + 2.0*p*std::cos(phi + 2.0*M_PI/3.0);
+        lambda[1] = 3.0*q - lambda[0] - lambda[2];
+    }
+    std::sort(lambda, lambda+3, [](double a, double b) { return a > b; });
+}
+
+eventshapes calculateEventShapes(const ObjectCollection *const *colls, int ncolls)
+{
+    eventshapes out = {0., 0., 0., 0., -1., -1., -1., -1.};
+
+    // momentum tensors {xx, yy, zz, xy, xz, yz}
+    double quad[6] = {0., 0., 0., 0., 0., 0.};
+    double lin[6] = {0., 0., 0., 0., 0., 0.};
+    double sump2 = 0.0, sump = 0.0;
+    int nobj = 0;
+    forEachObject(colls, ncolls, [&](double x, double y, double z) {
+        const double t[6] = {x*x, y*y, z*z, x*y, x*z, y*z};
+        const double p2 = t[0] + t[1] + t[2];
+        const double p = std::sqrt(p2);
+        for (int k=0; k<6; k++) quad[k] += t[k];
+        if (p > 0.0) for (int k=0; k<6; k++) lin[k] += t[k] / p;
+        sump2 += p2;
+        sump += p;
+        nobj++;
+    });
+    if (sump <= 0.0) return out;
+
+    // both tensors are positive semi-definite, clip rounding below zero
+    double l[3];
+    for (int k=0; k<6; k++) quad[k] /= sump2;
+    symEigenvalues3(quad, l);
+    for (int k=0; k<3; k++) l[k] = std::max(l[k], 0.0);
+    out.sphericity = 1.5 * (l[1] + l[2]);
+    out.aplanarity = 1.5 * l[2];
+
+    for (int k=0; k<6; k++) lin[k] /= sump;
+    symEigenvalues3(lin, l);
+    for (int k=0; k<3; k++) l[k] = std::max(l[k], 0.0);
+    out.C = 3.0 * (l[0]*l[1] + l[0]*l[2] + l[1]*l[2]);
+    out.D = 27.0 * l[0]*l[1]*l[2];
+
+    if (nobj < 2) return out;
+
+    double taxis[3], maxis[3];
+    findThrustAxis(colls, ncolls, sump, nullptr, taxis);
+    findThrustAxis(colls, ncolls, sump, taxis, maxis);
+    const double naxis[3] = {taxis[1]*maxis[2] - taxis[2]*maxis[1],
+                             taxis[2]*maxis[0] - taxis[0]*maxis[2],
+                             taxis[0]*maxis[1] - taxis[1]*maxis[0]};
+    out.thrust = sumAbsProjection(colls, ncolls, taxis) / sump;
+    out.thrustmajor = sumAbsProjection(colls, ncolls, maxis) / sump;
+    out.thrustminor = sumAbsProjection(colls, ncolls, naxis) / sump;
+    out.oblateness = out.thrustmajor - out.thrustminor;
+    return out;
+}
@@ -0,0 +1,46 @@
+/*
+ * EventShapes.h
+ *
+ *  Event shape variables computed directly on the arrays of ObjectCollection:
+ *  sphericity/aplanarity (quadratic momentum tensor), C/D (linearized
+ *  tensor), thrust, thrust major/minor and oblateness.
+ *  The 3x3 tensors are diagonalized in closed form. The thrust axes are
+ *  found by trying all sign combinations of the objects for up to 12
+ *  objects (exact), and by iterating from the sign combinations of the
+ *  hardest objects (as in JETSET) above. Nothing is allocated on the heap.
+ *  tools/checkeventshapes compares both with reference computations.
+ */
+
+#ifndef EVENTSHAPES_H_
+#define EVENTSHAPES_H_
+
+#include "ObjectCollection.h"
+
+struct eventshapes
+{
+    // quadratic tensor eigenvalues l1 >= l2 >= l3
+    float sphericity;   // 3/2 (l2 + l3)
+    float aplanarity;   // 3/2 l3
+    // linearized tensor eigenvalues
+    float C;            // 3 (l1 l2 + l1 l3 + l2 l3)
+    float D;            // 27 l1 l2 l3
+    // -1 for less than two objects
+    float thrust;
+    float thrustmajor;
+    float thrustminor;
+    float oblateness;   // major - minor
+};
+
+// eigenvalues of the symmetric matrix {xx, yy, zz, xy, xz, yz}, in descending order
+void symEigenvalues3(const double m[6], double lambda[3]);
+
+// all objects of the ncolls collections are used
+eventshapes calculateEventShapes(const ObjectCollection *const *colls, int ncolls);
+
+inline eventshapes calculateEventShapes(const ObjectCollection &objs)
+{
+    const ObjectCollection *colls[1] = {&objs};
+    return calculateEventShapes(colls, 1);
+}
+
+#endif /* EVENTSHAPES_H_ */
@@ -0,0 +1,74 @@
+/*
+ * GenRecord.cpp
+ *
+ *  Per-event index over the generator record.
+ */
+
+#include "GenRecord.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+GenRecord::GenRecord(const ints &pdgId, const ints &motherIdx)
+:_pdgId(pdgId.begin(), pdgId.end()), _mother(motherIdx.begin(), motherIdx.end())
+{
+    const int n = _pdgId.size();
+    _mother.resize(n, -1);
+
+    // daughters in CSR form, counting pass then filling pass
+    _offsets.assign(n+1, 0);
+    for (int i=0; i<n; i++) {
+        int m = _mother[i];
+        if (m >= 0 && m < n) _offsets[m+1]++;
+    }
+    for (int i=0; i<n; i++) _offsets[i+1] += _offsets[i];
+    _daughters.resize(_offsets[n]);
+    std::vector<int> fill(_offsets.begin(), _offsets.end()-1);
+    for (int i=0; i<n; i++) {
+        int m = _mother[i];
+        if (m >= 0 && m < n) _daughters[fill[m]++] = i;
+    }
+
+    // next copy: the last daughter with the same pdgId
+    _nextcopy.assign(n, -1);
+    for (int i=0; i<n; i++) {
+        for (int k=_offsets[i]; k<_offsets[i+1]; k++) {
+            if (_pdgId[_daughters[k]] == _pdgId[i]) _nextcopy[i] = _daughters[k];
+        }
+    }
+
+    // |pdgId| buckets
+    _byabsid.resize(n);
+    for (int i=0; i<n; i++) _byabsid[i] = i;
+    std::stable_sort(_byabsid.begin(), _byabsid.end(), [this](int a, int b) { return std::abs(_pdgId[a]) < std::abs(_pdgId[b]); });
+    _sortedabsid.resize(n);
+    for (int i=0; i<n; i++) _sortedabsid[i] = std::abs(_pdgId[_byabsid[i]]);
+}
+
+int GenRecord::lastCopy(int i) const {
+
+    // the chain cannot be longer than the record, this only guards against broken mother links
+    for (int step=0; step<size() && _nextcopy[i] >= 0; step++) i = _nextcopy[i];
+    return i;
+}
+
+bool GenRecord::hasNoDaughterWithAbsPdgId(int i, int absid) const {
+
+    for (int k=_offsets[i]; k<_offsets[i+1]; k++) {
+        if (std::abs(_pdgId[_daughters[k]]) == absid) return false;
+    }
+    return true;
+}
+
+std::pair<const int *, const int *> GenRecord::withAbsPdgId(int absid) const {
+
+    auto range = std::equal_range(_sortedabsid.begin(), _sortedabsid.end(), absid);
+    const int *first = _byabsid.data() + (range.first - _sortedabsid.begin());
+    const int *last = _byabsid.data() + (range.second - _sortedabsid.begin());
+    return {first, last};
+}
+
+GenRecord genRecord(ints &pdgId, ints &motherIdx)
+{
+    return GenRecord(pdgId, motherIdx);
+}
@@ -0,0 +1,59 @@
+/*
+ * GenRecord.h
+ *
+ *  Index over the generator record of one event (GenPart_pdgId,
+ *  GenPart_genPartIdxMother), built once and shared by the gen helpers in
+ *  utility.cpp:
+ *   - daughters of every particle in CSR form (offsets + flat index list,
+ *     daughters in increasing index order)
+ *   - for every particle the daughter that is its next copy (same pdgId),
+ *     so the last copy is found in O(depth)
+ *   - particle indices bucketed by |pdgId|
+ */
+
+#ifndef GENRECORD_H_
+#define GENRECORD_H_
+
+#include <utility>
+#include <vector>
+
+#include "utility.h"
+
+class GenRecord {
+public:
+    GenRecord() {}
+    GenRecord(const ints &pdgId, const ints &motherIdx);
+
+    int size() const { return _pdgId.size(); }
+    int pdgId(int i) const { return _pdgId[i]; }
+    int mother(int i) const { return _mother[i]; }
+
+    // daughters of i are daughters()[daughterBegin(i) .. daughterEnd(i)-1]
+    int daughterBegin(int i) const { return _offsets[i]; }
+    int daughterEnd(int i) const { return _offsets[i+1]; }
+    int ndaughters(int i) const { return _offsets[i+1] - _offsets[i]; }
+    const std::vector<int> &daughters() const { return _daughters; }
+
+    // follows daughters with the same pdgId down to the last copy of i
+    int lastCopy(int i) const;
+    // true if no daughter of i has |pdgId| == absid
+    bool hasNoDaughterWithAbsPdgId(int i, int absid) const;
+    // indices with |pdgId| == absid, in increasing order: [first, second)
+    std::pair<const int *, const int *> withAbsPdgId(int absid) const;
+
+private:
+    std::vector<int> _pdgId;
+    std::vector<int> _mother;
+    std::vector<int> _offsets;
+    std::vector<int> _daughters;
+    // last daughter with the same pdgId, -1 if none
+    std::vector<int> _nextcopy;
+    // particle indices sorted by (|pdgId|, index), and their |pdgId|
+    std::vector<int> _byabsid;
+    std::vector<int> _sortedabsid;
+};
+
+// RDataFrame helper
+GenRecord genRecord(ints &pdgId, ints &motherIdx);
+
+#endif /* GENRECORD_H_ */
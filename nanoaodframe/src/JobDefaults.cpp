@@ -0,0 +1,75 @@
+/*
+ * JobDefaults.cpp
+ *
+ *  Lookup tables of golden JSON files and global tags.
+ */
+
+#include "JobDefaults.h"
+
+namespace {
+
+struct jsonentry
+{
+    const char *year;   // prefix of the year option
+    const char *json;
+};
+
+const jsonentry goldenJSONs[] = {
+    {"2016", "data/GoldenJSON/Cert_271036-284044_13TeV_Legacy2016_Collisions16_JSON.txt"},
+    {"2017", "data/GoldenJSON/Cert_294927-306462_13TeV_UL2017_Collisions17_GoldenJSON.txt"},
+    {"2018", "data/GoldenJSON/Cert_314472-325175_13TeV_Legacy2018_Collisions18_JSON.txt"},
+};
+
+struct globaltagentry
+{
+    const char *pattern;    // substring of the input file name
+    const char *year;       // year option it applies to, "" for any
+    const char *globaltag;
+};
+
+// first match wins
+const globaltagentry globalTags[] = {
+    // data
+    {"Run2016B", "", "Summer19UL16APV_RunBCD_V7"},
+    {"Run2016C", "", "Summer19UL16APV_RunBCD_V7"},
+    {"Run2016D", "", "Summer19UL16APV_RunBCD_V7"},
+    {"Run2016E", "2016pre", "Summer19UL16APV_RunEF_V7"},
+    {"Run2016F", "2016pre", "Summer19UL16APV_RunEF_V7"},
+    {"Run2016F", "2016post", "Summer19UL16_RunFGH_V7"},
+    {"Run2016G", "2016post", "Summer19UL16_RunFGH_V7"},
+    {"Run2016H", "2016post", "Summer19UL16_RunFGH_V7"},
+    {"Run2017B", "2017", "Summer19UL17_RunB_V5"},
+    {"Run2017C", "2017", "Summer19UL17_RunC_V5"},
+    {"Run2017D", "2017", "Summer19UL17_RunD_V5"},
+    {"Run2017E", "2017", "Summer19UL17_RunE_V5"},
+    {"Run2017F", "2017", "Summer19UL17_RunF_V5"},
+    {"Run2018A", "2018", "Summer19UL18_RunA_V5"},
+    {"Run2018B", "2018", "Summer19UL18_RunB_V5"},
+    {"Run2018C", "2018", "Summer19UL18_RunC_V5"},
+    {"Run2018D", "2018", "Summer19UL18_RunD_V5"},
+    // MC
+    {"UL16NanoAODAPVv", "", "Summer19UL16APV_V7"},
+    {"UL16NanoAODv", "", "Summer19UL16_V7"},
+    {"UL17NanoAODv", "", "Summer19UL17_V5"},
+    {"UL18NanoAODv", "", "Summer19UL18_V5"},
+};
+
+} // namespace
+
+std::string defaultGoldenJSON(const std::string &year)
+{
+    for (auto &e : goldenJSONs) {
+        if (year.compare(0, 4, e.year) == 0) return e.json;
+    }
+    return "";
+}
+
+std::string defaultGlobalTag(const std::string &infile, const std::string &year)
+{
+    for (auto &e : globalTags) {
+        if (infile.find(e.pattern) == std::string::npos) continue;
+        if (e.year[0] != '\0' && year != e.year) continue;
+        return e.globaltag;
+    }
+    return "";
+}
@@ -0,0 +1,20 @@
+/*
+ * JobDefaults.h
+ *
+ *  Golden JSON and JetMET global tag used when a job does not specify them,
+ *  looked up from the year and the input file name (the tables used to live
+ *  in processonefile.py, processonedataset.py and skimonefile.py).
+ */
+
+#ifndef JOBDEFAULTS_H_
+#define JOBDEFAULTS_H_
+
+#include <string>
+
+// golden JSON of the data taking year ("2016pre", "2016post", "2017", "2018"), "" if unknown
+std::string defaultGoldenJSON(const std::string &year);
+
+// global tag for the input file: data run era (e.g. "Run2017C") or MC campaign (e.g. "UL17NanoAODv"), "" if unknown
+std::string defaultGlobalTag(const std::string &infile, const std::string &year);
+
+#endif /* JOBDEFAULTS_H_ */
@@ -7,6 +7,8 @@
  */
 
 #include "NanoAODAnalyzerrdframe.h"
+#include "ProcessingCache.h"
+#include "ColumnExport.h"
 #include <iostream>
 #include <algorithm>
 #include <typeinfo>
@@ -15,9 +17,13 @@
 #include <ctime>
 
 #include "TCanvas.h"
+#include "TChain.h"
+#include "TTreeCache.h"
 #include "Math/GenVector/VectorUtil.h"
 #include <vector>
 #include <fstream>
+#include <sstream>
+#include <iomanip>
 #include "utility.h"
 #include <regex>
 #include "ROOT/RDFHelpers.hxx"
@@ -25,8 +31,18 @@
 
 using namespace std;
 
+// sign of the generator weight, the MC event weight of the skim
+static const std::string unitGenWeightMC = "genWeight != 0 ? genWeight/abs(genWeight) : 0";
+
+// running sums of LHEPdfWeight, for Aggregate
+static floats addPDFWeights(floats sums, floats weights)
+{
+    for (size_t i=0; i<weights.size() && i<sums.size(); i++) sums[i] += weights[i];
+    return sums;
+}
+
 NanoAODAnalyzerrdframe::NanoAODAnalyzerrdframe(TTree *atree, std::string outfilename, std::string year, std::string syst, std::string jsonfname, std::string globaltag, int nthreads)
-:_rd(*atree), _isData(false), _jsonOK(false), _outfilename(outfilename), _year(year), _syst(syst), _jsonfname(jsonfname), _globaltag(globaltag), _inrootfile(0), _outrootfile(0), _rlm(_rd), _rnt(&_rlm), currentnode(0), PDFWeights(103, 0.0) {
+:_rd(*atree), _isData(false), _jsonOK(false), _outfilename(outfilename), _year(year), _syst(syst), _jsonfname(jsonfname), _globaltag(globaltag), _inrootfile(0), _outrootfile(0), _intree(atree), _rlm(_rd), _rnt(&_rlm), currentnode(0), PDFWeights(103, 0.0) {
 
     // record time
     auto start = std::chrono::system_clock::now();
@@ -42,6 +58,8 @@ NanoAODAnalyzerrdframe::NanoAODAnalyzerrdframe(TTree *atree, std::string outfile
     }
 
     // Year switch
+    // era dependent kernels are picked from _era, see EraPolicy.h
+    _era = eraFromYear(_year);
     if (_year.find("2016pre") != std::string::npos) {
         _isRun16pre = true;
         cout << "Year : Run 2016 pre (16 APV)" << endl;
@@ -61,6 +79,7 @@ NanoAODAnalyzerrdframe::NanoAODAnalyzerrdframe(TTree *atree, std::string outfile
     if (atree->GetBranch("genWeight") == nullptr) {
         _isData = true;
         cout << "Input file is data" <<endl;
+        if (_era == Era::Unknown) cout << "WARNING! no era in year " << _year << ", XY MET correction of data from the run ranges of all eras" << endl;
     } else {
         _isData = false;
         cout << "Input file is MC" <<endl;
@@ -74,26 +93,34 @@ NanoAODAnalyzerrdframe::NanoAODAnalyzerrdframe(TTree *atree, std::string outfile
         cout << "Nominal process without systematics" << endl;
     }
 
+    // names only, the branches actually read are reported after the event loop
     TObjArray *allbranches = atree->GetListOfBranches();
-    for (int i =0; i<allbranches->GetSize(); i++) {
+    _originalvars.reserve(allbranches->GetEntriesFast());
+    for (int i =0; i<allbranches->GetEntriesFast(); i++) {
         TBranch *abranch = dynamic_cast<TBranch *>(allbranches->At(i));
-        if (abranch!= nullptr) {
-            std::string brname = abranch->GetName();
-            if (brname.find("HLT_") == std::string::npos and brname.find("L1_") == std::string::npos)
-                cout << brname << ", ";
-            _originalvars.push_back(abranch->GetName());
-        }
+        if (abranch!= nullptr) _originalvars.push_back(abranch->GetName());
     }
-    cout << endl;
+    cout << "Input tree has " << _originalvars.size() << " branches" << endl;
+    _inputbytesstart = inputBytesRead();
 }
 
 NanoAODAnalyzerrdframe::~NanoAODAnalyzerrdframe() {
 
+    // the tree outlives the analyzer, the entry list does not
+    if (_preselected) _intree->SetEntryList(nullptr);
+
     // TODO Auto-generated destructor stub
     // ugly...
     std::cout<<">>  Job Done  <<"<<std::endl;
 }
 
+void NanoAODAnalyzerrdframe::setEntryRange(Long64_t begin, Long64_t end) {
+
+    // applied in setupAnalysis: a Range, or the bounds of the preselected entry list
+    _entrybegin = begin;
+    _entryend = end;
+}
+
 bool NanoAODAnalyzerrdframe::isDefined(string v) {
 
 	auto result = std::find(_originalvars.begin(), _originalvars.end(), v);
@@ -103,6 +130,8 @@ bool NanoAODAnalyzerrdframe::isDefined(string v) {
 
 void NanoAODAnalyzerrdframe::setTree(TTree *t, std::string outfilename) {
 
+	_intree = t;
+	_inputbytesstart = inputBytesRead();
 	_rd = ROOT::RDataFrame(*t);
 	_rlm = RNode(_rd);
 	_outfilename = outfilename;
@@ -116,30 +145,29 @@ void NanoAODAnalyzerrdframe::setTree(TTree *t, std::string outfilename) {
 
 void NanoAODAnalyzerrdframe::setupAnalysis() {
 
+    // entries before begin are skipped without reading any branch
+    if (_entryend >= 0 && !usePreselection()) _rlm = _rlm.Range(_entrybegin, _entryend);
+
     if (_isData) _jsonOK = readjson();
 
     //_rlm = _rlm.Filter("event < 12534199");
 
     _rlm = _rlm.Define("one", "1.0");
+    decodeQuantizedFactors();
     // Event weight for data it's always one. For MC, it depends on the sign
     if(_isSkim){
         _rlm = _rlm.Define("unitGenWeight", "one");
 
         if(!_isData){
 
-            // Store PDF sum of weights
-            auto storeWeights = [this](floats weights)->floats {
-
-                for (unsigned int i=0; i<weights.size(); i++)
-                    PDFWeights[i] += weights[i];
-
-                return PDFWeights;
-            };
-            try {
-                _rlm.Foreach(storeWeights, {"LHEPdfWeight"});
-            } catch (exception& e) {
-                cout << e.what() << endl;
-                cout << "No PDF weight in this root file!" << endl;
+            // Store PDF sum of weights, summed by the event loop of run() before any cut
+            // (with a preselection the sums are made in its loop, over all entries)
+            if (!usePreselection()) {
+                if (_rlm.HasColumn("LHEPdfWeight")) {
+                    _pdfsums = _rlm.Aggregate(addPDFWeights, addPDFWeights, "LHEPdfWeight", floats(PDFWeights.size(), 0.0));
+                } else {
+                    cout << "No PDF weight in this root file!" << endl;
+                }
             }
 
             // pu weight setup
@@ -160,13 +188,15 @@ void NanoAODAnalyzerrdframe::setupAnalysis() {
             _hpudata_minus->SetDirectory(0);
             tfdata.Close();
 
-            WeightCalculatorFromHistogram* _puweightcalc = new WeightCalculatorFromHistogram(_hpumc, _hpudata);
-            WeightCalculatorFromHistogram* _puweightcalc_plus = new WeightCalculatorFromHistogram(_hpumc, _hpudata_plus);
-            WeightCalculatorFromHistogram* _puweightcalc_minus = new WeightCalculatorFromHistogram(_hpumc, _hpudata_minus); 
+            WeightCalculatorFromHistogram _puweightcalc(_hpumc, _hpudata);
+            WeightCalculatorFromHistogram _puweightcalc_plus(_hpumc, _hpudata_plus);
+            WeightCalculatorFromHistogram _puweightcalc_minus(_hpumc, _hpudata_minus);
+            // nominal, up and down share the binning: one lookup gives all three
+            auto _putable = _sfservice.add("pileup", ScaleFactorTable(_puweightcalc.getHistogram(), _puweightcalc_plus.getHistogram(), _puweightcalc_minus.getHistogram()));
             //Check Normalisation issue for genWeight
-            _rlm = _rlm.Redefine("unitGenWeight","genWeight != 0 ? genWeight/abs(genWeight) : 0")
-                       .Define("puWeight", [this, _puweightcalc, _puweightcalc_plus, _puweightcalc_minus](float x) ->floats
-                              {return {_puweightcalc->getWeight(x), _puweightcalc_plus->getWeight(x), _puweightcalc_minus->getWeight(x)};}, {"Pileup_nTrueInt"});
+            _rlm = _rlm.Redefine("unitGenWeight", unitGenWeightMC)
+                       .Define("puWeight", [_putable](float x) ->floats
+                              {sfvalues w = _putable->get(x); return {w.nom, w.up, w.down};}, {"Pileup_nTrueInt"});
         }
     }
 
@@ -205,6 +235,53 @@ void NanoAODAnalyzerrdframe::setupAnalysis() {
     setupTree();
 }
 
+void NanoAODAnalyzerrdframe::setupPreselection() {
+
+    // phase 1: only the branches of the preselection, the counters and the PDF weights are read
+    ROOT::RDataFrame rd(*_intree);
+    RNode pre = rd;
+    if (_entryend >= 0) pre = pre.Range(_entrybegin, _entryend);
+    pre = pre.Define("one", "1.0");
+    if (_isSkim) pre = pre.Define("unitGenWeight", _isData ? "one" : unitGenWeightMC);
+
+    // histograms before the first cut must count every entry, not only the preselected ones
+    std::map<std::string, RDF1DHist> histos;
+    for (auto &x : _hist1dinfovector) {
+        if (x.mincutstep.length() != 0) continue;
+        std::string hname = std::string(x.hmodel.fName.Data()) + x.systname;
+        std::string weight = x.weightname + x.systname;
+        if (!pre.HasColumn(x.varname) || (weight != "" && !pre.HasColumn(weight))) {
+            cout << "WARNING! " << hname << " cannot be filled before the preselection, it counts preselected entries only" << endl;
+            continue;
+        }
+        TH1DModel model(hname.c_str(), x.hmodel.fTitle.Data(), x.hmodel.fNbinsX, x.hmodel.fXLow, x.hmodel.fXUp);
+        histos[hname] = weight != "" ? pre.Histo1D(model, x.varname, weight) : pre.Histo1D(model, x.varname);
+    }
+    // same sums as the Aggregate of setupAnalysis, booked to run in the same loop
+    const size_t npdf = PDFWeights.size();
+    bool haspdf = _isSkim && !_isData && pre.HasColumn("LHEPdfWeight");
+    RResultPtr<floats> pdfsums;
+    if (haspdf) pdfsums = pre.Aggregate(addPDFWeights, addPDFWeights, "LHEPdfWeight", floats(npdf, 0.0));
+    auto passed = pre.Filter(preselection(), "preselection").Take<ULong64_t>("rdfentry_");
+
+    _preselected.reset(new TEntryList("preselection", "preselected entries", _intree));
+    for (auto entry : *passed) _preselected->Enter(entry, _intree);
+    if (haspdf) {
+        for (size_t i=0; i<npdf; i++) PDFWeights[i] += (*pdfsums)[i];
+    } else if (_isSkim && !_isData) {
+        cout << "No PDF weight in this root file!" << endl;
+    }
+    for (auto &h : histos) {
+        _preselhistos[h.first].reset(static_cast<TH1D *>(h.second->Clone()));
+        _preselhistos[h.first]->SetDirectory(0);
+    }
+    Long64_t ntotal = _entryend >= 0 ? _entryend - _entrybegin : _intree->GetEntries();
+    cout << "Preselection: " << _preselected->GetN() << " of " << ntotal << " entries" << endl;
+
+    // phase 2: the event loop and its TTreeCache only visit the listed entries
+    _intree->SetEntryList(_preselected.get());
+}
+
 bool NanoAODAnalyzerrdframe::readjson() {
 
     auto isgoodjsonevent = [this](unsigned int runnumber, unsigned int lumisection) {
@@ -274,7 +351,7 @@ void NanoAODAnalyzerrdframe::selectElectrons() {
 
 void NanoAODAnalyzerrdframe::selectMuons() {
 
-    _rlm = _rlm.Define("muoncuts", "Muon_pt>50.0 && abs(Muon_eta)<2.4 && Muon_tightId && Muon_pfRelIso04_all<0.15")
+    _rlm = _rlm.Define("muoncuts", muonSelection)
                .Define("vetomuoncuts", "!muoncuts && Muon_pt>15.0 && abs(Muon_eta)<2.4 && Muon_looseId && Muon_pfRelIso04_all<0.25")
                .Define("nvetomuons","Sum(vetomuoncuts)")
                .Redefine("Muon_pt", "Muon_pt[muoncuts]")
@@ -293,9 +370,6 @@ void NanoAODAnalyzerrdframe::selectMuons() {
     cout<<"Loading Muon SF"<<endl;
     std::string muonFile = _year + "_UL";
     std::string muonTrgHist = "";
-    TFile *muontrg;
-    TFile *muonid;
-    TFile *muoniso;
 
     if (_isRun16pre) {
         muonFile = "2016_UL_HIPM";
@@ -308,82 +382,32 @@ void NanoAODAnalyzerrdframe::selectMuons() {
     } else if (_isRun18) {
         muonTrgHist = "NUM_IsoMu24_DEN_CutBasedIdTight_and_PFIsoTight_abseta_pt";
     }
-    muonid = TFile::Open(("data/MuonSF/Efficiencies_muon_generalTracks_Z_Run" + muonFile + "_ID.root").c_str());
-    TH2F* _hmuonid = dynamic_cast<TH2F *>(muonid->Get("NUM_TightID_DEN_TrackerMuons_abseta_pt"));
-    _hmuonid->SetDirectory(0);
-    muonid->Close();
-    WeightCalculatorFromHistogram* _muonid = new WeightCalculatorFromHistogram(_hmuonid);
-
-    muoniso = TFile::Open(("data/MuonSF/Efficiencies_muon_generalTracks_Z_Run" + muonFile + "_ISO.root").c_str());
-    TH2F* _hmuoniso = dynamic_cast<TH2F *>(muoniso->Get("NUM_TightRelIso_DEN_TightIDandIPCut_abseta_pt"));
-    _hmuoniso->SetDirectory(0);
-    muoniso->Close();
-    WeightCalculatorFromHistogram* _muoniso = new WeightCalculatorFromHistogram(_hmuoniso);
-
-    muontrg = TFile::Open(("data/MuonSF/Efficiencies_muon_generalTracks_Z_Run" + muonFile + "_SingleMuonTriggers.root").c_str());
-    TH2F* _hmuontrg = dynamic_cast<TH2F *>(muontrg->Get(muonTrgHist.c_str()));
-    _hmuontrg->SetDirectory(0);
-    muontrg->Close();
-    WeightCalculatorFromHistogram* _muontrg = new WeightCalculatorFromHistogram(_hmuontrg);
+    std::string muonSFPath = "data/MuonSF/Efficiencies_muon_generalTracks_Z_Run" + muonFile;
+    auto _muonid = _sfservice.load("muonId", muonSFPath + "_ID.root", "NUM_TightID_DEN_TrackerMuons_abseta_pt");
+    auto _muoniso = _sfservice.load("muonIso", muonSFPath + "_ISO.root", "NUM_TightRelIso_DEN_TightIDandIPCut_abseta_pt");
+    auto _muontrg = _sfservice.load("muonTrg", muonSFPath + "_SingleMuonTriggers.root", muonTrgHist);
 
     // We have only one muon!
-    auto muonSFId = [this, _muonid](floats &pt, floats &eta)->floats {
+    // Id, Iso and Trg (cent, up, down) from one pass over the tables
+    auto muonSF = [_muonid, _muoniso, _muontrg](floats &pt, floats &eta)->floats {
 
-        floats wVec;
-        wVec.reserve(3); //cent, up, down
+        if (pt.size() != 1) return {1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0};
 
-        if (pt.size() == 1) {
-            for (unsigned int i=0; i<pt.size(); i++) {
-                float sf = _muonid->getWeight(std::abs(eta[i]),pt[i]);
-                float err = _muonid->getWeightErr(std::abs(eta[i]),pt[i]);
-                wVec.emplace_back(sf);
-                wVec.emplace_back(sf + err);
-                wVec.emplace_back(sf - err);
-            }
-        }
-        else wVec = {1.0, 1.0, 1.0};
-        return wVec;
+        float abseta = std::abs(eta[0]);
+        sfvalues id = _muonid->get(abseta, pt[0]);
+        sfvalues iso = _muoniso->get(abseta, pt[0]);
+        sfvalues trg = _muontrg->get(abseta, pt[0]);
+        return {id.nom, id.up, id.down, iso.nom, iso.up, iso.down, trg.nom, trg.up, trg.down};
     };
 
-    auto muonSFIso = [this, _muoniso](floats &pt, floats &eta)->floats {
-
-        floats wVec;
-        wVec.reserve(3); //cent, up, down
-
-        if (pt.size() == 1) {
-            for (unsigned int i=0; i<pt.size(); i++) {
-                float sf = _muoniso->getWeight(std::abs(eta[i]),pt[i]);
-                float err = _muoniso->getWeightErr(std::abs(eta[i]),pt[i]);
-                wVec.emplace_back(sf);
-                wVec.emplace_back(sf + err);
-                wVec.emplace_back(sf - err);
-            }
-        }
-        else wVec = {1.0, 1.0, 1.0};
-        return wVec;
-    };
-
-    auto muonSFTrg = [this, _muontrg](floats &pt, floats &eta)->floats {
-
-        floats wVec;
-        wVec.reserve(3); //cent, up, down
-
-        if (pt.size() == 1) {
-            for (unsigned int i=0; i<pt.size(); i++) {
-                float sf = _muontrg->getWeight(std::abs(eta[i]),pt[i]);
-                float err = _muontrg->getWeightErr(std::abs(eta[i]),pt[i]);
-                wVec.emplace_back(sf);
-                wVec.emplace_back(sf + err);
-                wVec.emplace_back(sf - err);
-            }
-        }
-        else wVec = {1.0, 1.0, 1.0};
-        return wVec;
+    auto muonSFSlice = [](unsigned int first) {
+        return [first](floats &sfs)->floats { return {sfs[first], sfs[first+1], sfs[first+2]}; };
     };
 
-    _rlm = _rlm.Define("muonWeightId", muonSFId, {"Muon_pt","Muon_eta"})
-               .Define("muonWeightIso", muonSFIso, {"Muon_pt","Muon_eta"})
-               .Define("muonWeightTrg", muonSFTrg, {"Muon_pt","Muon_eta"});
+    _rlm = _rlm.Define("muonSFs", muonSF, {"Muon_pt","Muon_eta"})
+               .Define("muonWeightId", muonSFSlice(0), {"muonSFs"})
+               .Define("muonWeightIso", muonSFSlice(3), {"muonSFs"})
+               .Define("muonWeightTrg", muonSFSlice(6), {"muonSFs"});
 }
 
 /*
@@ -392,79 +416,10 @@ void NanoAODAnalyzerrdframe::selectMET()
     _rlm = _rlm.Define("met4vec", ::genmet4vec, {"MET_pt","MET_phi"});
 }*/
 
-void NanoAODAnalyzerrdframe::setupJetMETCorrection(string globaltag, std::vector<std::string> jes_var, std::string jetalgo, bool dataMc) {
-
-    std::vector<JetCorrectionUncertainty*> regroupedUnc;
-    FactorizedJetCorrector* _jetCorrector;
-
-    if (_globaltag != "") {
-        cout << "Applying new JetMET corrections. GT: " + _globaltag + " on jetAlgo: AK4PFchs" << endl;
-        string basedirectory = "data/jes/";
-
-        string datamcflag = "";
-        if (dataMc) datamcflag = "DATA";
-        else datamcflag = "MC";
+template <typename Policy>
+void NanoAODAnalyzerrdframe::defineJetMETCorrections(FactorizedJetCorrector *_jetCorrector, std::vector<JetCorrectionUncertainty*> regroupedUnc, bool dataMc) {
 
-        // set file names that contain the parameters for corrections
-        string dbfilenamel1 = basedirectory + _globaltag + "_" + datamcflag + "_L1FastJet_" + jetalgo + ".txt";
-        string dbfilenamel2 = basedirectory + _globaltag + "_" + datamcflag + "_L2Relative_" + jetalgo + ".txt";
-        string dbfilenamel3 = basedirectory + _globaltag + "_" + datamcflag + "_L3Absolute_" + jetalgo + ".txt";
-        string dbfilenamel2l3 = basedirectory + _globaltag + "_" + datamcflag + "_L2L3Residual_" + jetalgo + ".txt";
-
-        JetCorrectorParameters *L1JetCorrPar = new JetCorrectorParameters(dbfilenamel1);
-        if (!L1JetCorrPar->isValid()) {
-          std::cerr << "L1FastJet correction parameters not read" << std::endl;
-          exit(1);
-        }
-
-        JetCorrectorParameters *L2JetCorrPar = new JetCorrectorParameters(dbfilenamel2);
-        if (!L2JetCorrPar->isValid()) {
-            std::cerr << "L2Relative correction parameters not read" << std::endl;
-            exit(1);
-        }
-
-        JetCorrectorParameters *L3JetCorrPar = new JetCorrectorParameters(dbfilenamel3);
-        if (!L3JetCorrPar->isValid()) {
-            std::cerr << "L3Absolute correction parameters not read" << std::endl;
-            exit(1);
-        }
-
-        JetCorrectorParameters *L2L3JetCorrPar = new JetCorrectorParameters(dbfilenamel2l3);
-        if (!L2L3JetCorrPar->isValid()) {
-            std::cerr << "L2L3Residual correction parameters not read" << std::endl;
-            exit(1);
-        }
-
-        // to apply all the corrections, first collect them into a vector
-        std::vector<JetCorrectorParameters> jetc;
-        jetc.push_back(*L1JetCorrPar);
-        jetc.push_back(*L2JetCorrPar);
-        jetc.push_back(*L3JetCorrPar);
-        jetc.push_back(*L2L3JetCorrPar);
-
-        // apply the various corrections
-        _jetCorrector = new FactorizedJetCorrector(jetc);
-
-        // object to calculate uncertainty
-        if (!dataMc) {
-            cout<<"Applying JEC Uncertainty"<<endl;
-            for (std::string src : jes_var) {
-                if (src.find("up") != std::string::npos) {
-                    if (src.find("HEM") != std::string::npos) continue;
-                    auto uncsource = src.substr(3, src.size()-2-3);
-                    cout << "JEC Uncertainty Source : " + uncsource << endl;
-                    string dbfilenameunc = basedirectory + "RegroupedV2_" + _globaltag + "_MC_UncertaintySources_AK4PFchs.txt";
-                    JetCorrectorParameters* uncCorrPar = new JetCorrectorParameters(dbfilenameunc, uncsource);
-                    JetCorrectionUncertainty* _jetCorrectionUncertainty = new JetCorrectionUncertainty(*uncCorrPar);
-                    regroupedUnc.emplace_back(_jetCorrectionUncertainty);
-                } else {
-                    continue; //We only need var name, no up/down
-                }
-            }
-        }
-    }
-
-    auto applyJes = [this, _jetCorrector](floats jetpts, floats jetetas, floats jetAreas, floats jetrawf, float rho, floats tocorrect)->floats {
+    auto applyJes = [_jetCorrector](floats jetpts, floats jetetas, floats jetAreas, floats jetrawf, float rho, floats tocorrect)->floats {
 
         floats corrfactors;
         corrfactors.reserve(jetpts.size());
@@ -484,7 +439,7 @@ void NanoAODAnalyzerrdframe::setupJetMETCorrection(string globaltag, std::vector
     };
 
     // structure: jes[jetIdx][varIdx]
-    auto jesUnc = [this, regroupedUnc](floats jetpts, floats jetetas, floats jetphis, floats jetAreas, floats jetrawf, float rho)->floatsVec {
+    auto jesUnc = [regroupedUnc](floats jetpts, floats jetetas, floats jetphis, floats jetAreas, floats jetrawf, float rho)->floatsVec {
 
         floats uncSources;
         uncSources.reserve(2 * regroupedUnc.size());
@@ -503,9 +458,10 @@ void NanoAODAnalyzerrdframe::setupJetMETCorrection(string globaltag, std::vector
                 uncSources.emplace_back(1.0f - unc);
             }
             // HEM - consider 2018 only
-            if (_year == "2018") {
-                if (jetphis[i] > -1.57 && jetphis[i] < -0.87 && jetetas[i] > -2.5 && jetetas[i] < -1.3) {
-                    uncSources.emplace_back(0.8);
+            if constexpr (Policy::era_type::hasHEM) {
+                constexpr hemregion hem = Policy::era_type::hem;
+                if (jetphis[i] > hem.phimin && jetphis[i] < hem.phimax && jetetas[i] > hem.etamin && jetetas[i] < hem.etamax) {
+                    uncSources.emplace_back(hem.sf);
                     uncSources.emplace_back(1.0);
                 } else {
                     uncSources.insert(uncSources.end(), 2, 1.0);
@@ -517,7 +473,7 @@ void NanoAODAnalyzerrdframe::setupJetMETCorrection(string globaltag, std::vector
         return uncertainties;
     };
 
-    auto metCorr = [=](float met, float metphi, floats jetptsbefore, floats jetptsafter, floats jetphis, int npv, unsigned int _runnb)->float {
+    auto metCorr = [](float met, float metphi, floats jetptsbefore, floats jetptsafter, floats jetphis, int npv, unsigned int _runnb)->float {
 
         int runnb = int(_runnb);
 
@@ -538,42 +494,9 @@ void NanoAODAnalyzerrdframe::setupJetMETCorrection(string globaltag, std::vector
         auto uncormet_phi = float(atan2(mety, metx));
 
         if(npv>100) npv=100;
-        auto METxcorr(0.),METycorr(0.);
-        if (!_isData) {
-            //UL2016
-            if(_isRun16pre) METxcorr = -(-0.153497 * npv + -0.231751);
-            if(_isRun16pre) METycorr = -(0.00731978 * npv + 0.243323);
-            if(_isRun16post) METxcorr = -(-0.188743 * npv + 0.136539);
-            if(_isRun16post) METycorr = -(0.0127927 * npv + 0.117747);
-            //UL2017
-            if(_isRun17) METxcorr = -(-0.300155 * npv + 1.90608);
-            if(_isRun17) METycorr = -(0.300213 * npv + -2.02232);
-            //UL2018
-            if(_isRun18) METxcorr = -(0.183518 * npv + 0.546754);
-            if(_isRun18) METycorr = -(0.192263 * npv + -0.42121);
-        }
-        if (_isData) {
-            //UL2018
-            if(runnb >= 315252 && runnb <= 316995 ) {METxcorr = -(0.263733 * npv + -1.91115); METycorr = -(0.0431304 * npv + -0.112043);}
-            if(runnb >= 316998 && runnb <= 319312 ) {METxcorr = -(0.400466 * npv + -3.05914); METycorr = -(0.146125 * npv + -0.533233);}
-            if(runnb >= 319313 && runnb <= 320393 ) {METxcorr = -(0.430911 * npv + -1.42865); METycorr = -(0.0620083 * npv + -1.46021);}
-            if(runnb >= 320394 && runnb <= 325273 ) {METxcorr = -(0.457327 * npv + -1.56856); METycorr = -(0.0684071 * npv + -0.928372);}
-            //UL2017
-            if(runnb >= 297020 && runnb <= 299329 ) {METxcorr = -(-0.211161 * npv + 0.419333); METycorr = -(0.251789 * npv + -1.28089);}
-            if(runnb >= 299337 && runnb <= 302029 ) {METxcorr = -(-0.185184 * npv + -0.164009); METycorr = -(0.200941 * npv + -0.56853);}
-            if(runnb >= 302030 && runnb <= 303434 ) {METxcorr = -(-0.201606 * npv + 0.426502); METycorr = -(0.188208 * npv + -0.58313);}
-            if(runnb >= 303435 && runnb <= 304826 ) {METxcorr = -(-0.162472 * npv + 0.176329); METycorr = -(0.138076 * npv + -0.250239);}
-            if(runnb >= 304911 && runnb <= 306462 ) {METxcorr = -(-0.210639 * npv + 0.72934); METycorr = -(0.198626 * npv + 1.028);}
-            //UL2016
-            if(runnb >= 272007 && runnb <= 275376 ) {METxcorr = -(-0.0214894 * npv + -0.188255); METycorr = -(0.0876624 * npv + 0.812885);}
-            if(runnb >= 275657 && runnb <= 276283 ) {METxcorr = -(-0.032209 * npv + 0.067288); METycorr = -(0.113917 * npv + 0.743906);}
-            if(runnb >= 276315 && runnb <= 276811 ) {METxcorr = -(-0.0293663 * npv + 0.21106); METycorr = -(0.11331 * npv + 0.815787);}
-            if(runnb >= 276831 && runnb <= 277420 ) {METxcorr = -(-0.0132046 * npv + 0.20073); METycorr = -(0.134809 * npv + 0.679068);}
-            if(((runnb >= 277772 && runnb <= 278768) || runnb==278770)) {METxcorr = -(-0.0543566 * npv + 0.816597); METycorr = -(0.114225 * npv + 1.17266);};
-            if(((runnb >= 278801 && runnb <= 278808) || runnb==278769)) {METxcorr = -(0.134616 * npv + -0.89965); METycorr = -(0.0397736 * npv + 1.0385);};
-            if(runnb >= 278820 && runnb <= 280385 ) {METxcorr = -(0.121809 * npv + -0.584893); METycorr = -(0.0558974 * npv + 0.891234);};
-            if(runnb >= 280919 && runnb <= 284044 ) {METxcorr = -(0.0868828 * npv + -0.703489); METycorr = -(0.0888774 * npv + 0.902632);};
-        }
+        double METxcorr, METycorr;
+        Policy::metXYCorrection(npv, runnb, METxcorr, METycorr);
+
         auto CorrectedMET_x = uncormet * cos( uncormet_phi ) + METxcorr;
         auto CorrectedMET_y = uncormet * sin( uncormet_phi ) + METycorr;
 
@@ -602,7 +525,7 @@ void NanoAODAnalyzerrdframe::setupJetMETCorrection(string globaltag, std::vector
         return corrfactors;
     };
 
-    auto metPhiCorr = [=](float met, float metphi, floats jetptsbefore, floats jetptsafter, floats jetphis, int npv, unsigned int _runnb)->float {
+    auto metPhiCorr = [](float met, float metphi, floats jetptsbefore, floats jetptsafter, floats jetphis, int npv, unsigned int _runnb)->float {
 
         int runnb = int(_runnb);
 
@@ -623,43 +546,8 @@ void NanoAODAnalyzerrdframe::setupJetMETCorrection(string globaltag, std::vector
         auto uncormet_phi = float(atan2(mety, metx));
 
         if(npv>100) npv=100;
-        auto METxcorr(0.),METycorr(0.);
-
-        if (!_isData) {
-            //UL2016
-            if (_isRun16pre) METxcorr = -(-0.153497 * npv + -0.231751);
-            if (_isRun16pre) METycorr = -(0.00731978 * npv + 0.243323);
-            if (_isRun16post) METxcorr = -(-0.188743 * npv + 0.136539);
-            if (_isRun16post) METycorr = -(0.0127927 * npv + 0.117747);
-            //UL2017
-            if (_isRun17) METxcorr = -(-0.300155 * npv + 1.90608);
-            if (_isRun17) METycorr = -(0.300213 * npv + -2.02232);
-            //UL2018
-            if (_isRun18) METxcorr = -(0.183518 * npv + 0.546754);
-            if (_isRun18) METycorr = -(0.192263 * npv + -0.42121);
-        }
-        if (_isData) {
-            //UL2018
-            if (runnb >= 315252 && runnb <= 316995 ) {METxcorr = -(0.263733 * npv + -1.91115); METycorr = -(0.0431304 * npv + -0.112043);}
-            if (runnb >= 316998 && runnb <= 319312 ) {METxcorr = -(0.400466 * npv + -3.05914); METycorr = -(0.146125 * npv + -0.533233);}
-            if (runnb >= 319313 && runnb <= 320393 ) {METxcorr = -(0.430911 * npv + -1.42865); METycorr = -(0.0620083 * npv + -1.46021);}
-            if (runnb >= 320394 && runnb <= 325273 ) {METxcorr = -(0.457327 * npv + -1.56856); METycorr = -(0.0684071 * npv + -0.928372);}
-            //UL2017
-            if (runnb >= 297020 && runnb <= 299329 ) {METxcorr = -(-0.211161 * npv + 0.419333); METycorr = -(0.251789 * npv + -1.28089);}
-            if (runnb >= 299337 && runnb <= 302029 ) {METxcorr = -(-0.185184 * npv + -0.164009); METycorr = -(0.200941 * npv + -0.56853);}
-            if (runnb >= 302030 && runnb <= 303434 ) {METxcorr = -(-0.201606 * npv + 0.426502); METycorr = -(0.188208 * npv + -0.58313);}
-            if (runnb >= 303435 && runnb <= 304826 ) {METxcorr = -(-0.162472 * npv + 0.176329); METycorr = -(0.138076 * npv + -0.250239);}
-            if (runnb >= 304911 && runnb <= 306462 ) {METxcorr = -(-0.210639 * npv + 0.72934); METycorr = -(0.198626 * npv + 1.028);}
-            //UL2016
-            if (runnb >= 272007 && runnb <= 275376 ) {METxcorr = -(-0.0214894 * npv + -0.188255); METycorr = -(0.0876624 * npv + 0.812885);}
-            if (runnb >= 275657 && runnb <= 276283 ) {METxcorr = -(-0.032209 * npv + 0.067288); METycorr = -(0.113917 * npv + 0.743906);}
-            if (runnb >= 276315 && runnb <= 276811 ) {METxcorr = -(-0.0293663 * npv + 0.21106); METycorr = -(0.11331 * npv + 0.815787);}
-            if (runnb >= 276831 && runnb <= 277420 ) {METxcorr = -(-0.0132046 * npv + 0.20073); METycorr = -(0.134809 * npv + 0.679068);}
-            if (((runnb >= 277772 && runnb <= 278768) || runnb==278770)) {METxcorr = -(-0.0543566 * npv + 0.816597); METycorr = -(0.114225 * npv + 1.17266);};
-            if (((runnb >= 278801 && runnb <= 278808) || runnb==278769)) {METxcorr = -(0.134616 * npv + -0.89965); METycorr = -(0.0397736 * npv + 1.0385);};
-            if (runnb >= 278820 && runnb <= 280385 ) {METxcorr = -(0.121809 * npv + -0.584893); METycorr = -(0.0558974 * npv + 0.891234);};
-            if (runnb >= 280919 && runnb <= 284044 ) {METxcorr = -(0.0868828 * npv + -0.703489); METycorr = -(0.0888774 * npv + 0.902632);};
-        }
+        double METxcorr, METycorr;
+        Policy::metXYCorrection(npv, runnb, METxcorr, METycorr);
 
         auto CorrectedMET_x = uncormet * cos( uncormet_phi ) + METxcorr;
         auto CorrectedMET_y = uncormet * sin( uncormet_phi ) + METycorr;
@@ -710,7 +598,84 @@ void NanoAODAnalyzerrdframe::setupJetMETCorrection(string globaltag, std::vector
         }
         _rlm = _rlm.Redefine("Jet_pt", "Jet_pt_corr");
     }
+}
+
+void NanoAODAnalyzerrdframe::setupJetMETCorrection(string globaltag, std::vector<std::string> jes_var, std::string jetalgo, bool dataMc) {
+
+    std::vector<JetCorrectionUncertainty*> regroupedUnc;
+    FactorizedJetCorrector* _jetCorrector = nullptr;
+
+    if (_globaltag != "") {
+        cout << "Applying new JetMET corrections. GT: " + _globaltag + " on jetAlgo: AK4PFchs" << endl;
+        string basedirectory = "data/jes/";
+
+        string datamcflag = "";
+        if (dataMc) datamcflag = "DATA";
+        else datamcflag = "MC";
+
+        // set file names that contain the parameters for corrections
+        string dbfilenamel1 = basedirectory + _globaltag + "_" + datamcflag + "_L1FastJet_" + jetalgo + ".txt";
+        string dbfilenamel2 = basedirectory + _globaltag + "_" + datamcflag + "_L2Relative_" + jetalgo + ".txt";
+        string dbfilenamel3 = basedirectory + _globaltag + "_" + datamcflag + "_L3Absolute_" + jetalgo + ".txt";
+        string dbfilenamel2l3 = basedirectory + _globaltag + "_" + datamcflag + "_L2L3Residual_" + jetalgo + ".txt";
+
+        JetCorrectorParameters *L1JetCorrPar = new JetCorrectorParameters(dbfilenamel1);
+        if (!L1JetCorrPar->isValid()) {
+          std::cerr << "L1FastJet correction parameters not read" << std::endl;
+          exit(1);
+        }
+
+        JetCorrectorParameters *L2JetCorrPar = new JetCorrectorParameters(dbfilenamel2);
+        if (!L2JetCorrPar->isValid()) {
+            std::cerr << "L2Relative correction parameters not read" << std::endl;
+            exit(1);
+        }
+
+        JetCorrectorParameters *L3JetCorrPar = new JetCorrectorParameters(dbfilenamel3);
+        if (!L3JetCorrPar->isValid()) {
+            std::cerr << "L3Absolute correction parameters not read" << std::endl;
+            exit(1);
+        }
+
+        JetCorrectorParameters *L2L3JetCorrPar = new JetCorrectorParameters(dbfilenamel2l3);
+        if (!L2L3JetCorrPar->isValid()) {
+            std::cerr << "L2L3Residual correction parameters not read" << std::endl;
+            exit(1);
+        }
+
+        // to apply all the corrections, first collect them into a vector
+        std::vector<JetCorrectorParameters> jetc;
+        jetc.push_back(*L1JetCorrPar);
+        jetc.push_back(*L2JetCorrPar);
+        jetc.push_back(*L3JetCorrPar);
+        jetc.push_back(*L2L3JetCorrPar);
+
+        // apply the various corrections
+        _jetCorrector = new FactorizedJetCorrector(jetc);
+
+        // object to calculate uncertainty
+        if (!dataMc) {
+            cout<<"Applying JEC Uncertainty"<<endl;
+            for (std::string src : jes_var) {
+                if (src.find("up") != std::string::npos) {
+                    if (src.find("HEM") != std::string::npos) continue;
+                    auto uncsource = src.substr(3, src.size()-2-3);
+                    cout << "JEC Uncertainty Source : " + uncsource << endl;
+                    string dbfilenameunc = basedirectory + "RegroupedV2_" + _globaltag + "_MC_UncertaintySources_AK4PFchs.txt";
+                    JetCorrectorParameters* uncCorrPar = new JetCorrectorParameters(dbfilenameunc, uncsource);
+                    JetCorrectionUncertainty* _jetCorrectionUncertainty = new JetCorrectionUncertainty(*uncCorrPar);
+                    regroupedUnc.emplace_back(_jetCorrectionUncertainty);
+                } else {
+                    continue; //We only need var name, no up/down
+                }
+            }
+        }
+    }
 
+    // era dependent kernels (HEM, XY MET) are instantiated for this era only
+    dispatchEra(_era, _isData, [&](auto policy) {
+        defineJetMETCorrections<decltype(policy)>(_jetCorrector, regroupedUnc, dataMc);
+    });
 
     // JER
     std::string jetResFilePath_ = "data/jer/";
@@ -1029,32 +994,22 @@ void NanoAODAnalyzerrdframe::selectJets(std::vector<std::string> jes_var) {
                .Redefine("Jet_phi", "Jet_phi[jetcuts]")
                .Redefine("Jet_mass", "Jet_mass[jetcuts]")
                .Redefine("Jet_btagDeepFlavB", "Jet_btagDeepFlavB[jetcuts]")
-               .Define("jet4vecs", ::gen4vec, {"Jet_pt", "Jet_eta", "Jet_phi", "Jet_mass"});
+               .Define("jetcoll", ::genCollection, {"Jet_pt", "Jet_eta", "Jet_phi", "Jet_mass"});
+    _workcolumns.push_back("jetcoll");
 
     if (!_isData) {
         _rlm = _rlm.Redefine("btagWeight_DeepFlavB_perJet", skimCol, {"btagWeight_DeepFlavB_perJet", "jetcuts"})
                    .Redefine("btagWeight_DeepFlavB_jes_perJet", skimCol, {"btagWeight_DeepFlavB_jes_perJet", "jetcuts"});
     }
 
-    // for checking overlapped jets with leptons
-    auto checkoverlap = [](FourVectorVec &seljets, FourVectorVec &sellep) {
-
-        ints mindrlepton;
-        for (auto ajet: seljets) {
-            auto mindr = 6.0;
-            for ( auto alepton : sellep ) {
-                auto dr = ROOT::Math::VectorUtil::DeltaR(ajet, alepton);
-                if (dr < mindr) mindr = dr;
-            }
-            int out = mindr >= 0.4 ? 1 : 0;
-            mindrlepton.emplace_back(out);
-        }
-        return mindrlepton;
+    // for checking overlapped jets with leptons: 1 if the jet is kept
+    auto checkoverlap = [](ObjectCollection &seljets, ObjectCollection &sellep) {
+        return overlapMask(seljets, sellep, 0.4f);
     };
 
     // Overlap removal with muon (used for btagging SF)
-    _rlm = _rlm.Define("muonjetoverlap", checkoverlap, {"jet4vecs","muon4vecs"})
-               .Define("taujetoverlap", checkoverlap, {"jet4vecs","cleantau4vecs"})
+    _rlm = _rlm.Define("muonjetoverlap", checkoverlap, {"jetcoll","muoncoll"})
+               .Define("taujetoverlap", checkoverlap, {"jetcoll","cleantaucoll"})
                .Define("jetoverlap","muonjetoverlap && taujetoverlap");
 
     _rlm = _rlm.Redefine("Jet_pt", "Jet_pt[jetoverlap]")
@@ -1110,44 +1065,35 @@ void NanoAODAnalyzerrdframe::selectTaus() {
     //TES var.
     if (!_isData) {
 
-        auto selectTES = [syst_unc](floatsVec unc)->floats {
+        // Tau_pt_unc holds (up, down) per tau
+        int idx = -1;
+        if (syst_unc.find("tesup") != std::string::npos) idx = 0;
+        else if (syst_unc.find("tesdown") != std::string::npos) idx = 1;
 
-            int idx = -1;
-            if (syst_unc.find("tesup") != std::string::npos) idx = 0;
-            else if (syst_unc.find("tesdown") != std::string::npos) idx = 1;
-            floats selected;
-            selected.reserve(unc.size());
+        auto selectTES = [idx](floatsVec &unc)->floats {
 
-            for (size_t i=0; i<unc.size(); i++) {
-                if (idx < 0) selected.emplace_back(1.0f);
-                selected.emplace_back(unc[i][idx]);
-                std::cout << idx << " " << unc[i][idx]  << endl;
-            }
+            floats selected(unc.size());
+            for (size_t i=0; i<unc.size(); i++) selected[i] = unc[i][idx];
             return selected;
         };
 
-        if (_syst.find("tes") != std::string::npos) {
-          _rlm = _rlm.Define("Tau_pt_unc_toapply", selectTES, {"Tau_pt_unc"})
-                     .Redefine("Tau_pt", "Tau_pt * Tau_pt_unc_toapply")
-                     .Redefine("Tau_mass", "Tau_mass * Tau_pt_unc_toapply");
+        if (idx >= 0) {
+            _rlm = _rlm.Define("Tau_pt_unc_toapply", selectTES, {"Tau_pt_unc"})
+                       .Redefine("Tau_pt", "Tau_pt * Tau_pt_unc_toapply")
+                       .Redefine("Tau_mass", "Tau_mass * Tau_pt_unc_toapply");
         }
     }
 
-    auto overlap_removal_mutau = [](FourVectorVec &muon4vecs, FourVectorVec &tau4vecs) {
-        ints out;
-        for (auto tau: tau4vecs) {
-            int check = 0;
-            for (auto mu: muon4vecs) {
-                auto dR = ROOT::Math::VectorUtil::DeltaR(mu, tau);
-                if( dR >= 0.4 ) check = 1;
-            }
-            out.emplace_back(check);
-        }
-        return out;
+    // 1 if the tau is not within 0.4 of any selected muon
+    auto overlap_removal_mutau = [](ObjectCollection &muons, ObjectCollection &taus) {
+        return overlapMask(taus, muons, 0.4f);
     };
 
-    _rlm = _rlm.Define("tau4vecs", ::gen4vec, {"Tau_pt", "Tau_eta", "Tau_phi", "Tau_mass"})
-               .Define("mutauoverlap", overlap_removal_mutau, {"muon4vecs","tau4vecs"});
+    // muons come from the skim as muon4vecs
+    _rlm = _rlm.Define("muoncoll", ::genCollectionFrom4vec, {"muon4vecs"})
+               .Define("taucoll", ::genCollection, {"Tau_pt", "Tau_eta", "Tau_phi", "Tau_mass"})
+               .Define("mutauoverlap", overlap_removal_mutau, {"muoncoll","taucoll"});
+    _workcolumns.insert(_workcolumns.end(), {"muoncoll", "taucoll"});
 
     // input vector: vec[pt][vars]
     auto skimCol = [this](floatsVec toSkim, ints cut)->floatsVec {
@@ -1175,7 +1121,9 @@ void NanoAODAnalyzerrdframe::selectTaus() {
                .Redefine("Tau_jetIdx", "Tau_jetIdx[seltaucuts]")
                .Redefine("Tau_decayMode", "Tau_decayMode[seltaucuts]")
                .Define("ncleantaupass", "int(Tau_pt.size())")
-               .Define("cleantau4vecs", ::gen4vec, {"Tau_pt", "Tau_eta", "Tau_phi", "Tau_mass"});
+               .Define("cleantau4vecs", ::gen4vec, {"Tau_pt", "Tau_eta", "Tau_phi", "Tau_mass"})
+               .Define("cleantaucoll", ::genCollection, {"Tau_pt", "Tau_eta", "Tau_phi", "Tau_mass"});
+    _workcolumns.push_back("cleantaucoll");
 
     if (!_isData) {
         _rlm = _rlm.Redefine("Tau_genPartFlav","Tau_genPartFlav[seltaucuts]")
@@ -1188,7 +1136,10 @@ void NanoAODAnalyzerrdframe::selectTaus() {
 
 void NanoAODAnalyzerrdframe::matchGenReco() {
 
-    _rlm = _rlm.Define("FinalGenPart_idx", ::FinalGenPart_idx, {"GenPart_pdgId", "GenPart_genPartIdxMother"})
+    // generator record index, built once per event for all gen queries
+    // (not named gen* so that it is never matched by the skim output patterns)
+    _rlm = _rlm.Define("truthrecord", ::genRecord, {"GenPart_pdgId", "GenPart_genPartIdxMother"})
+               .Define("FinalGenPart_idx", [](GenRecord &rec) { return FinalGenPart_idx(rec); }, {"truthrecord"})
                .Define("GenPart_LFVup_idx", "FinalGenPart_idx[0]")
                .Define("GenPart_LFVmuon_idx", "FinalGenPart_idx[1]")
                .Define("GenPart_LFVtau_idx", "FinalGenPart_idx[2]")
@@ -1197,15 +1148,31 @@ void NanoAODAnalyzerrdframe::matchGenReco() {
                .Define("GenPart_SMW2_idx", "FinalGenPart_idx[5]")
                .Define("GenPart_LFVtop_idx", "FinalGenPart_idx[6]")
                .Define("GenPart_SMtop_idx", "FinalGenPart_idx[7]");
+    _workcolumns.push_back("truthrecord");
+
+    // FinalGenPart_idx slots: 0 up, 1 muon, 2 tau, 3 b, 4 W1, 5 W2
+    // reco collections: 0 muons, 1 taus, 2 jets
+    const std::vector<dRmatchrequest> matchrequests = {
+        {1, 0, 0.15}, // Muon_matched
+        {2, 1, 0.4},  // Tau_matched
+        {0, 2, 0.4},  // Jet_LFVup_matched
+        {3, 2, 0.4},  // Jet_SMb_matched
+        {4, 2, 0.4},  // Jet_SMW1_matched
+        {5, 2, 0.4}   // Jet_SMW2_matched
+    };
+    auto matchAll = [matchrequests](const ints &genidx, const floats &geneta, const floats &genphi, const floats &mueta, const floats &muphi,
+                                    const floats &taueta, const floats &tauphi, const floats &jeteta, const floats &jetphi) {
+        const dRmatchcollection recos[3] = {{&mueta, &muphi}, {&taueta, &tauphi}, {&jeteta, &jetphi}};
+        return dRmatching_multi(genidx, geneta, genphi, recos, 3, matchrequests);
+    };
 
-    _rlm = _rlm.Define("drmax1", "float(0.15)")
-               .Define("drmax2", "float(0.4)")
-               .Define("Muon_matched", ::dRmatching_binary,{"GenPart_LFVmuon_idx","drmax1","GenPart_pt","GenPart_eta","GenPart_phi","GenPart_mass","Muon_pt","Muon_eta","Muon_phi","Muon_mass"})
-               .Define("Tau_matched",::dRmatching_binary,{"GenPart_LFVtau_idx","drmax2", "GenPart_pt","GenPart_eta","GenPart_phi","GenPart_mass","Tau_pt","Tau_eta","Tau_phi","Tau_mass"})
-               .Define("Jet_LFVup_matched",::dRmatching_binary,{"GenPart_LFVup_idx","drmax2","GenPart_pt","GenPart_eta","GenPart_phi","GenPart_mass","Jet_pt","Jet_eta","Jet_phi","Jet_mass"})
-               .Define("Jet_SMb_matched",::dRmatching_binary,{"GenPart_SMb_idx","drmax2","GenPart_pt","GenPart_eta","GenPart_phi","GenPart_mass","Jet_pt","Jet_eta","Jet_phi","Jet_mass"})
-               .Define("Jet_SMW1_matched",::dRmatching_binary,{"GenPart_SMW1_idx","drmax2","GenPart_pt","GenPart_eta","GenPart_phi","GenPart_mass","Jet_pt","Jet_eta","Jet_phi","Jet_mass"})
-               .Define("Jet_SMW2_matched",::dRmatching_binary,{"GenPart_SMW2_idx","drmax2", "GenPart_pt","GenPart_eta","GenPart_phi","GenPart_mass","Jet_pt","Jet_eta","Jet_phi","Jet_mass"})
+    _rlm = _rlm.Define("matchedmasks", matchAll, {"FinalGenPart_idx", "GenPart_eta", "GenPart_phi", "Muon_eta", "Muon_phi", "Tau_eta", "Tau_phi", "Jet_eta", "Jet_phi"})
+               .Define("Muon_matched", "matchedmasks[0]")
+               .Define("Tau_matched", "matchedmasks[1]")
+               .Define("Jet_LFVup_matched", "matchedmasks[2]")
+               .Define("Jet_SMb_matched", "matchedmasks[3]")
+               .Define("Jet_SMW1_matched", "matchedmasks[4]")
+               .Define("Jet_SMW2_matched", "matchedmasks[5]")
                .Define("Sel_muon_matched","Muon_matched[muoncuts]")
                .Define("Sel_tau_matched","Tau_matched[seltaucuts]")
                .Define("Sel2_LFVupjet_matched","Jet_LFVup_matched[jetcuts][muonjetoverlap][taujetoverlap]")
@@ -1224,6 +1191,8 @@ void NanoAODAnalyzerrdframe::matchGenReco() {
                .Define("nJet_SMb_matched", "Sum(Jet_SMb_matched)")
                .Define("nJet_SMW1_matched", "Sum(Jet_SMW1_matched)")
                .Define("nJet_SMW2_matched", "Sum(Jet_SMW2_matched)");
+    // the masks are stored as Muon_matched, ..., Jet_SMW2_matched
+    _workcolumns.push_back("matchedmasks");
 }
 
 void NanoAODAnalyzerrdframe::selectFatJets() {
@@ -1244,11 +1213,11 @@ void NanoAODAnalyzerrdframe::topPtReweight() {
                .Define("GenPart_top_pt", "GenPart_pt[gentopcut]");
 
     // To be updated for nanoaod n9
-    auto topPtLOtoNLO = [](floats toppt)->float {
+    auto topPtLOtoNLO = [](floats &toppt)->float {
 
+        constexpr auto &xbins = TopPtLOtoNLO::xbins;
+        constexpr auto &sfs = TopPtLOtoNLO::sfs;
         float out = 1.0;
-        std::vector<float> xbins = {0,50,100,150,200,250,300,350,400,450,500,550,600,800,1000,2000};
-        std::vector<float> sfs = {1.1536, 1.0578, 0.993, 0.9373, 0.8881, 0.8456, 0.8087, 0.7809, 0.7559, 0.7388, 0.7247, 0.7245, 0.7124, 0.7284, 0.7317};
 
         if (toppt.size() != 2) out = 1.0;
         else {
@@ -1258,7 +1227,7 @@ void NanoAODAnalyzerrdframe::topPtReweight() {
             if (pt2 > 2000) pt2 = 1999;
             int xbin1 = (std::upper_bound(xbins.begin(), xbins.end(), pt1)-1) - xbins.begin();
             int xbin2 = (std::upper_bound(xbins.begin(), xbins.end(), pt2)-1) - xbins.begin();
-            out = std::sqrt( sfs.at(xbin1) * sfs.at(xbin2));
+            out = std::sqrt( sfs[xbin1] * sfs[xbin2]);
         }
         return out;
     };
@@ -1321,48 +1290,46 @@ void NanoAODAnalyzerrdframe::calculateEvWeight() {
     auto _tauidSFmu  = tauSFreader->at("DeepTau2017v2p1VSmu");
     auto _testool    = tauSFreader->at("tau_energy_scale");
 
+    // string categories and per-slot argument buffers are set up once here
+    unsigned int nslots = _rd.GetNSlots();
+    auto _tesbatch = std::make_shared<CorrectionAdapter>(_testool, 4, std::vector<correction::Variable::Type>{std::string("DeepTau2017v2p1")}, std::vector<std::string>{"nom", "up", "down"}, nslots);
+    auto _tauidSFelebatch = std::make_shared<CorrectionAdapter>(_tauidSFele, 2, std::vector<correction::Variable::Type>{tauid_vse}, std::vector<std::string>{"nom", "up", "down"}, nslots);
+    auto _tauidSFmubatch = std::make_shared<CorrectionAdapter>(_tauidSFmu, 2, std::vector<correction::Variable::Type>{tauid_vsmu}, std::vector<std::string>{"nom", "up", "down"}, nslots);
+
     // Tau ES
     cout<<"Applying TauES on Genuine taus"<<endl;
-    auto tauES = [this, _testool](floats &pt, floats &eta, ints &dm, uchars &genid, floats &x)->floats {
+    // (nom, up, down) per tau, evaluated once and shared by Tau_pt, Tau_mass and Tau_pt_unc
+    auto tauES = [_tesbatch](unsigned int slot, floats &pt, floats &eta, ints &dm, uchars &genid)->floats {
 
-        floats xout;
+        floats es(3*pt.size(), 1.0f);
 
         for (unsigned int i=0; i<pt.size(); i++) {
-            float es = 1.0;
-            if (int(genid[i])==1 || int(genid[i])==3 || int(genid[i])==5) {
-                if (dm[i]!=5 and dm[i]!=6)
-                    es = _testool->evaluate({pt[i], eta[i], dm[i], int(genid[i]), "DeepTau2017v2p1", "nom"});
-            }
-            xout.emplace_back(x[i]*es);
+            int gen = int(genid[i]);
+            if ((gen==1 || gen==3 || gen==5) && dm[i]!=5 && dm[i]!=6)
+                _tesbatch->evaluate(slot, &es[3*i], double(pt[i]), double(eta[i]), dm[i], gen);
         }
-        return xout;
+        return es;
     };
 
-    auto tauESUnc = [this, _testool](floats &pt, floats &eta, ints &dm, uchars &genid, floats &x)->floatsVec {
+    auto applyES = [](floats &x, floats &es)->floats {
 
-        floats uncSources;
-        uncSources.reserve(2);
-        floatsVec xout;
-        xout.reserve(pt.size());
+        floats xout(x.size());
+        for (unsigned int i=0; i<x.size(); i++) xout[i] = x[i]*es[3*i];
+        return xout;
+    };
 
-        for (unsigned int i=0; i<pt.size(); i++) {
-            if (int(genid[i])==1 || int(genid[i])==3 || int(genid[i])==5) {
-                if (dm[i]!=5 and dm[i]!=6) {
-                    uncSources.emplace_back(_testool->evaluate({pt[i], eta[i], dm[i], int(genid[i]), "DeepTau2017v2p1", "up"}));
-                    uncSources.emplace_back(_testool->evaluate({pt[i], eta[i], dm[i], int(genid[i]), "DeepTau2017v2p1", "down"}));
-                }
-            }
-            else uncSources = {1.0f, 1.0f};
-            xout.emplace_back(uncSources);
-            uncSources.clear();
-        }
+    auto tauESUnc = [](floats &es)->floatsVec {
+
+        floatsVec xout(es.size()/3);
+        for (unsigned int i=0; i<xout.size(); i++) xout[i] = {es[3*i+1], es[3*i+2]};
         return xout;
     };
 
         _rlm = _rlm.Define("Tau_pt_uncor", "Tau_pt")
-               .Redefine("Tau_pt", tauES, {"Tau_pt_uncor", "Tau_eta", "Tau_decayMode", "Tau_genPartFlav", "Tau_pt_uncor"})
-               .Redefine("Tau_mass", tauES, {"Tau_pt_uncor", "Tau_eta", "Tau_decayMode", "Tau_genPartFlav", "Tau_mass"})
-               .Define("Tau_pt_unc", tauESUnc, {"Tau_pt_uncor", "Tau_eta", "Tau_decayMode", "Tau_genPartFlav", "Tau_pt_uncor"});
+               .DefineSlot("Tau_es", tauES, {"Tau_pt_uncor", "Tau_eta", "Tau_decayMode", "Tau_genPartFlav"})
+               .Redefine("Tau_pt", applyES, {"Tau_pt_uncor", "Tau_es"})
+               .Redefine("Tau_mass", applyES, {"Tau_mass", "Tau_es"})
+               .Define("Tau_pt_unc", tauESUnc, {"Tau_es"});
 
 
     // ID SFs
@@ -1401,104 +1368,36 @@ void NanoAODAnalyzerrdframe::calculateEvWeight() {
     };
     */
 
-    TauIDSFTool* _tauidSFjet;
-    TauIDSFTool* _tauidSFjetHighPt;
-    _tauidSFjet = new TauIDSFTool(tauYear, "DeepTau2017v2p1VSjet", tauid_vsjet, tauid_vse, false, true, false, false);
-    _tauidSFjetHighPt = new TauIDSFTool(tauYear, "DeepTau2017v2p1VSjet", tauid_vsjet, tauid_vse, false, false, false, true);
-
-    auto tauSFIdVsJet = [this, _tauidSFjet, _tauidSFjetHighPt, tauYear](floats &pt, floats &eta, uchars &genid, ints dm)->floatsVec {
+    TauIDSFTool _tauidSFjet(tauYear, "DeepTau2017v2p1VSjet", tauid_vsjet, tauid_vse, false, true, false, false);
+    TauIDSFTool _tauidSFjetHighPt(tauYear, "DeepTau2017v2p1VSjet", tauid_vsjet, tauid_vse, false, false, false, true);
+    // all 27 slots per (DM, pt) are tabulated once, the tools are not needed afterwards
+    auto _tauidSFjetTable = std::make_shared<const TauIDSFVsJetTable>(_tauidSFjet, _tauidSFjetHighPt, tauYear.substr(2));
 
-        floats uncSources;
-        uncSources.reserve(27); //nom + syst 40 + highPT 2
-        floatsVec wVec;
-        wVec.reserve(pt.size());
+    auto tauSFIdVsJet = [_tauidSFjetTable](floats &pt, floats &eta, uchars &genid, ints &dm)->floatsVec {
 
-        auto year_ = tauYear.substr(2);
-        std::vector<std::string> uncerts = {"uncert0", "uncert1", "syst_alleras", "syst_" + year_, "syst_dmX_" + year_};
-        std::vector<std::string> uncertsHighPt = {"stat","stat_bin1","stat_bin2","syst","extrap"};
+        floatsVec wVec(pt.size(), floats(TauIDSFVsJetTable::nslots));
 
-        if (pt.size() > 0) {
-            for (unsigned int i=0; i<pt.size(); i++) {
-                // TauSFTool will take care of pt > 140 SF by setting pT = 140
-                float nomsf = _tauidSFjet->getSFvsDMandPT(pt[i], dm[i], int(genid[i]));
-                float nomsf_highpt = _tauidSFjetHighPt->getHighPTSFvsPT(pt[i], int(genid[i]));
-                uncSources.emplace_back(nomsf);
-
-                if (pt[i] <= 140) {
-                    for (auto unc : uncerts) {
-                        size_t pos = unc.find("dmX");
-                        if (pos != std::string::npos) { //indices 9-16
-                            unc.replace(pos, 3, "dm"+std::to_string(dm[i]));
-                            float upsf = _tauidSFjet->getSFvsDMandPT(pt[i], dm[i], int(genid[i]), unc + "_up");
-                            float dnsf = _tauidSFjet->getSFvsDMandPT(pt[i], dm[i], int(genid[i]), unc + "_down");
-                            std::vector<float> dmsf;
-                            if      (dm[i] == 0)  dmsf = {upsf, dnsf, nomsf, nomsf, nomsf, nomsf, nomsf, nomsf};
-                            else if (dm[i] == 1)  dmsf = {nomsf, nomsf, upsf, dnsf, nomsf, nomsf, nomsf, nomsf};
-                            else if (dm[i] == 10) dmsf = {nomsf, nomsf, nomsf, nomsf, upsf, dnsf, nomsf, nomsf};
-                            else if (dm[i] == 11) dmsf = {nomsf, nomsf, nomsf, nomsf, nomsf, nomsf, upsf, dnsf};
-                            else                  dmsf = {nomsf, nomsf, nomsf, nomsf, nomsf, nomsf, nomsf, nomsf}; //placeholder
-                            uncSources.insert(uncSources.end(), dmsf.begin(), dmsf.end());
-                        } else { //indices 1-8
-                            uncSources.emplace_back(_tauidSFjet->getSFvsDMandPT(pt[i], dm[i], int(genid[i]), unc + "_up"));
-                            uncSources.emplace_back(_tauidSFjet->getSFvsDMandPT(pt[i], dm[i], int(genid[i]), unc + "_down"));
-                        }
-                    }
-                    uncSources.insert(uncSources.end(), 10, nomsf);
-                } else {
-                    uncSources.insert(uncSources.end(), 16, nomsf_highpt);
-                    for (auto unc : uncertsHighPt) {
-                        uncSources.emplace_back(_tauidSFjetHighPt->getHighPTSFvsPT(pt[i], int(genid[i]), unc + "_up"));
-                        uncSources.emplace_back(_tauidSFjetHighPt->getHighPTSFvsPT(pt[i], int(genid[i]), unc + "_down"));
-                    }
-                }
-                wVec.emplace_back(uncSources);
-                uncSources.clear();
-            }
-        }
-        return wVec;
-    };
-
-    auto tauSFIdVsEl = [this, _tauidSFele, tauid_vse](floats &pt, floats &eta, uchars &genid)->floatsVec {
-
-        floats uncSources;
-        uncSources.reserve(3);
-        floatsVec wVec;
-        wVec.reserve(pt.size());
-
-        if (pt.size() > 0) {
-            for (unsigned int i=0; i<pt.size(); i++) {
-                uncSources.emplace_back(_tauidSFele->evaluate({abs(eta[i]), int(genid[i]), tauid_vse, "nom"}));
-                uncSources.emplace_back(_tauidSFele->evaluate({abs(eta[i]), int(genid[i]), tauid_vse, "up"}));
-                uncSources.emplace_back(_tauidSFele->evaluate({abs(eta[i]), int(genid[i]), tauid_vse, "down"}));
-                wVec.emplace_back(uncSources);
-                uncSources.clear();
-            }
+        for (unsigned int i=0; i<pt.size(); i++) {
+            //nom + syst 16 (pt <= 140) or highPT 10 (pt > 140)
+            _tauidSFjetTable->fill(pt[i], dm[i], int(genid[i]), wVec[i].data());
         }
         return wVec;
     };
 
-    auto tauSFIdVsMu = [this, _tauidSFmu, tauid_vsmu](floats &pt, floats &eta, uchars &genid)->floatsVec {
-
-        floats uncSources;
-        uncSources.reserve(3);
-        floatsVec wVec;
-        wVec.reserve(pt.size());
+    // (nom, up, down) per tau from one batched call
+    auto tauSFIdVsLep = [](std::shared_ptr<CorrectionAdapter> sfbatch) {
+        return [sfbatch](unsigned int slot, floats &pt, floats &eta, uchars &genid)->floatsVec {
 
-        if (pt.size() > 0) {
-            for (unsigned int i=0; i<pt.size(); i++) {
-                uncSources.emplace_back(_tauidSFmu->evaluate({abs(eta[i]), int(genid[i]), tauid_vsmu, "nom"}));
-                uncSources.emplace_back(_tauidSFmu->evaluate({abs(eta[i]), int(genid[i]), tauid_vsmu, "up"}));
-                uncSources.emplace_back(_tauidSFmu->evaluate({abs(eta[i]), int(genid[i]), tauid_vsmu, "down"}));
-                wVec.emplace_back(uncSources);
-                uncSources.clear();
-            }
-        }
-        return wVec;
+            floatsVec wVec(pt.size(), floats(3));
+            for (unsigned int i=0; i<pt.size(); i++)
+                sfbatch->evaluate(slot, wVec[i].data(), double(std::abs(eta[i])), int(genid[i]));
+            return wVec;
+        };
     };
 
     _rlm = _rlm.Define("tauWeightIdVsJet", tauSFIdVsJet, {"Tau_pt","Tau_eta","Tau_genPartFlav", "Tau_decayMode"})
-               .Define("tauWeightIdVsEl", tauSFIdVsEl, {"Tau_pt","Tau_eta","Tau_genPartFlav"})
-               .Define("tauWeightIdVsMu", tauSFIdVsMu, {"Tau_pt","Tau_eta","Tau_genPartFlav"});
+               .DefineSlot("tauWeightIdVsEl", tauSFIdVsLep(_tauidSFelebatch), {"Tau_pt","Tau_eta","Tau_genPartFlav"})
+               .DefineSlot("tauWeightIdVsMu", tauSFIdVsLep(_tauidSFmubatch), {"Tau_pt","Tau_eta","Tau_genPartFlav"});
 
 }
 
@@ -1527,11 +1426,23 @@ void NanoAODAnalyzerrdframe::setupCuts_and_Hists() {
         if (c.mincutstep.length()==0) _rlm = _rlm.Define(c.varname, c.vardefinition);
     }
 
+    // networks need their inputs, which may be any of the variables above
+    for (auto &d : _dnninfovector) {
+        std::string inputs = "";
+        for (auto &name : d.model->inputNames()) inputs += (inputs.empty() ? "float(" : ", float(") + name + ")";
+        auto model = d.model;
+        int node = d.node;
+        _rlm = _rlm.Define(d.varname + "_inputs", "ROOT::VecOps::RVec<float>({" + inputs + "})")
+                   .DefineSlot(d.varname, [model, node](unsigned int slot, const floats &x)
+                               { return model->score(slot, x, node); }, {d.varname + "_inputs"});
+    }
+
     for (auto &x : _hist1dinfovector) {
         std::string hpost = "";
 
         if (x.mincutstep.length()==0) {
             helper_1DHistCreator(std::string(x.hmodel.fName.Data())+hpost+x.systname,  std::string(x.hmodel.fTitle.Data()), x.hmodel.fNbinsX, x.hmodel.fXLow, x.hmodel.fXUp, x.varname, x.weightname+x.systname, &_rlm);
+            _histshapes[std::string(x.hmodel.fName.Data())+hpost+x.systname] = {x.hmodel.fName.Data(), "", x.systname, nullptr};
         }
     }
 
@@ -1552,8 +1463,10 @@ void NanoAODAnalyzerrdframe::setupCuts_and_Hists() {
             if (acut.idx.compare(0, x.mincutstep.length(), x.mincutstep)==0) {
                 bool reachedMax = false;
                 if (x.maxcutstep.length() > 0 and acut.idx.compare(0, x.maxcutstep.length(), x.maxcutstep)>=0) reachedMax = true;
-                if (!reachedMax)
+                if (!reachedMax) {
                     helper_1DHistCreator(std::string(x.hmodel.fName.Data())+hpost+x.systname,  std::string(x.hmodel.fTitle.Data()), x.hmodel.fNbinsX, x.hmodel.fXLow, x.hmodel.fXUp, x.varname, x.weightname+x.systname, rnext);
+                    _histshapes[std::string(x.hmodel.fName.Data())+hpost+x.systname] = {x.hmodel.fName.Data(), cutname, x.systname, nullptr};
+                }
             }
         }
         _rnt.addDaughter(rnext, acut.idx);
@@ -1592,6 +1505,41 @@ void NanoAODAnalyzerrdframe::addVar(varinfo v) {
 	_varinfovector.push_back(v);
 }
 
+bool NanoAODAnalyzerrdframe::addDNN(std::string varname, std::string modelfile, int node) {
+
+	auto model = std::make_shared<const DNNModel>(modelfile, _rd.GetNSlots());
+	if (!model->isValid() || node >= model->noutputs()) {
+		cout << "WARNING! DNN " << varname << " not defined, model " << modelfile << " could not be used" << endl;
+		return false;
+	}
+	_dnninfovector.push_back({varname, modelfile, model, node});
+	return true;
+}
+
+std::string NanoAODAnalyzerrdframe::configurationSummary() const {
+
+    // one item per line, used as ProcessingCache key
+    std::ostringstream out;
+    out << "analyzer " << typeid(*this).name() << "\n";
+    out << "year " << _year << "\nsyst " << _syst << "\nskim " << _isSkim << "\nhtstitching " << _isHTstitching << "\n";
+    out << "json " << _jsonfname << " " << ProcessingCache::fileHash(_jsonfname) << "\n";
+    out << "globaltag " << _globaltag << "\n";
+    for (auto &v : _varinfovector) out << "var " << v.varname << " = " << v.vardefinition << " @" << v.mincutstep << "\n";
+    for (auto &c : _cutinfovector) out << "cut " << c.idx << " " << c.cutdefinition << "\n";
+    for (auto &h : _hist1dinfovector) {
+        // the bin edges of variable binning too, at full precision
+        out << "hist " << h.hmodel.fName << ";" << h.hmodel.fTitle << ";" << h.hmodel.fNbinsX << ";" << std::setprecision(17) << h.hmodel.fXLow << ";" << h.hmodel.fXUp << ";";
+        for (auto edge : h.hmodel.fBinXEdges) out << edge << ",";
+        out << std::setprecision(6) << " " << h.varname << " " << h.weightname << " " << h.systname << " @" << h.mincutstep << "-" << h.maxcutstep << "\n";
+    }
+    for (auto &d : _dnninfovector) out << "dnn " << d.varname << " " << d.modelfile << " " << ProcessingCache::fileHash(d.modelfile) << " " << d.node << "\n";
+    for (auto &v : _varstostore) out << "store " << v << "\n";
+    for (auto &v : _exportcolumns) out << "export " << v << "\n";
+    out << "dense " << _densehistograms << "\n";
+    out << "quantize " << _quantizefactors << "\n";
+    return out.str();
+}
+
 void NanoAODAnalyzerrdframe::addVartoStore(string varname) {
 
     // varname is assumed to be a regular expression.
@@ -1612,6 +1560,16 @@ void NanoAODAnalyzerrdframe::addVartoStore(string varname) {
 
 }
 
+void NanoAODAnalyzerrdframe::setColumnExport(std::vector<std::string> columns, std::string dir) {
+
+    _exportcolumns = columns;
+    _exportdir = dir;
+    if (_exportdir == "") {
+        _exportdir = _outfilename;
+        _exportdir.replace(_exportdir.rfind(".root"), 5, "_columns");
+    }
+}
+
 void NanoAODAnalyzerrdframe::setupTree() {
 
     vector<RNodeTree *> rntends;
@@ -1638,6 +1596,63 @@ void NanoAODAnalyzerrdframe::setupTree() {
         }
         _varstostorepertree[nodename]  = varforthistree;
     }
+    if (!_quantizefactors) return;
+
+    // the stored scale factors are replaced by their 16 bit codes on every output tree
+    _quantized.clear();
+    _sfclamped = std::make_shared<std::atomic<ULong64_t>>(0);
+    auto clamped = _sfclamped;
+    for (auto arnt: rntends) {
+        RNode *arnode = arnt->getRNode();
+        auto &stored = _varstostorepertree[arnt->getIndex()];
+        for (auto c : SFCodec::defaultColumns()) {
+            auto it = std::find(stored.begin(), stored.end(), c.column);
+            if (it == stored.end()) continue;
+            std::string type = arnode->GetColumnType(c.column);
+            float precision = c.precision;
+            if (type.find("RVec<ROOT::VecOps::RVec<float>") != std::string::npos || type.find("RVec<RVec<float>") != std::string::npos) {
+                c.nested = true;
+                *arnode = arnode->Define(SFCodec::encodedName(c.column), [precision, clamped](const floatsVec &x) { return SFCodec::encodeFlat(x, precision, *clamped); }, {c.column})
+                                 .Define(SFCodec::sizesName(c.column), SFCodec::sizes, {c.column});
+            } else if (type.find("RVec<float>") != std::string::npos) {
+                c.nested = false;
+                *arnode = arnode->Define(SFCodec::encodedName(c.column), [precision, clamped](const floats &x) { return SFCodec::encode(x, precision, *clamped); }, {c.column});
+            } else {
+                cout << "WARNING! " << c.column << " is " << type << ", stored as it is" << endl;
+                continue;
+            }
+            *it = SFCodec::encodedName(c.column);
+            if (c.nested) stored.insert(it + 1, SFCodec::sizesName(c.column));
+            if (std::none_of(_quantized.begin(), _quantized.end(), [&](const sfcodecinfo &q) { return q.column == c.column; })) _quantized.push_back(c);
+        }
+    }
+}
+
+void NanoAODAnalyzerrdframe::decodeQuantizedFactors() {
+
+    // the codes and their precisions of a quantized skim, see setupTree
+    bool hascodes = std::any_of(_originalvars.begin(), _originalvars.end(), [](const std::string &v) {
+        return v.size() > 4 && v.compare(v.size()-4, 4, "_q16") == 0;
+    });
+    if (!hascodes) return;
+    TFile *f = _intree->GetCurrentFile();
+    if (f == nullptr && _intree->LoadTree(0) >= 0) f = _intree->GetCurrentFile();
+    auto columns = SFCodec::read(f);
+    if (columns.empty()) {
+        cout << "ERROR! quantized scale factors in the input but no " << SFCodec::objectName << ", not decoded" << endl;
+        return;
+    }
+    for (auto &c : columns) {
+        std::string code = SFCodec::encodedName(c.column);
+        if (!isDefined(code) || isDefined(c.column)) continue;
+        float precision = c.precision;
+        if (c.nested) {
+            _rlm = _rlm.Define(c.column, [precision](const shorts &q, const ints &n) { return SFCodec::decode(q, n, precision); }, {code, SFCodec::sizesName(c.column)});
+        } else {
+            _rlm = _rlm.Define(c.column, [precision](const shorts &q) { return SFCodec::decode(q, precision); }, {code});
+        }
+        cout << "Decoding " << c.column << " from " << code << ", precision " << precision << endl;
+    }
 }
 
 void NanoAODAnalyzerrdframe::addCuts(string cut, string idx) {
@@ -1646,6 +1661,68 @@ void NanoAODAnalyzerrdframe::addCuts(string cut, string idx) {
 }
 
 
+void NanoAODAnalyzerrdframe::setInputBranches(const std::vector<std::string> &branches) {
+
+    TTree *t = _intree->GetTree() != nullptr ? _intree->GetTree() : _intree;
+    Long64_t zipbytes = 0;
+    for (auto &bname : branches) {
+        TBranch *b = t->GetBranch(bname.c_str());
+        if (b == nullptr) {
+            cout << "WARNING! input branch " << bname << " not found, reading all branches" << endl;
+            return;
+        }
+        zipbytes += b->GetZipBytes("*");
+    }
+    _intree->SetBranchStatus("*", 0);
+    for (auto &bname : branches) _intree->SetBranchStatus(bname.c_str(), 1);
+
+    // one cluster of the used branches, the cache then reads each cluster in one go
+    Long64_t clusterentries = t->GetEntries();
+    auto it = t->GetClusterIterator(0);
+    it();
+    if (it.GetNextEntry() > 0) clusterentries = it.GetNextEntry();
+    Long64_t cachesize = t->GetEntries() > 0 ? 1.2 * zipbytes * clusterentries / t->GetEntries() : 0;
+    cachesize = std::max<Long64_t>(cachesize, 1 << 20);
+    _intree->SetCacheSize(cachesize);
+    for (auto &bname : branches) _intree->AddBranchToCache(bname.c_str(), true);
+    _intree->StopCacheLearningPhase();
+    cout << "Reading " << branches.size() << " of " << _originalvars.size() << " branches, TTreeCache of "
+         << cachesize / 1024 << " kB" << endl;
+}
+
+Long64_t NanoAODAnalyzerrdframe::inputBytesRead() const {
+
+    if (dynamic_cast<TChain *>(_intree) != nullptr) return TFile::GetFileBytesRead();
+    TFile *f = _intree->GetCurrentFile();
+    return f != nullptr ? f->GetBytesRead() : 0;
+}
+
+void NanoAODAnalyzerrdframe::reportInputRead() {
+
+    TFile *f = _intree->GetCurrentFile();
+    TTree *t = _intree->GetTree() != nullptr ? _intree->GetTree() : _intree;
+    if (f == nullptr) return;
+
+    // the TTreeReader of the event loop puts exactly the branches of the graph in the cache
+    _inputbranches.clear();
+    Long64_t usedzipbytes = 0;
+    TTreeCache *cache = t->GetReadCache(f);
+    const TObjArray *cached = cache != nullptr ? cache->GetCachedBranches() : nullptr;
+    for (int i=0; cached != nullptr && i<cached->GetEntriesFast(); i++) {
+        TBranch *b = dynamic_cast<TBranch *>(cached->At(i));
+        if (b == nullptr || b->GetMother() != b) continue;
+        _inputbranches.push_back(b->GetName());
+        usedzipbytes += b->GetZipBytes("*");
+    }
+    bool ischain = dynamic_cast<TChain *>(_intree) != nullptr;
+    Long64_t bytesread = inputBytesRead() - _inputbytesstart;
+    cout << "Input read: " << _inputbranches.size() << " of " << _originalvars.size() << " branches ("
+         << usedzipbytes / 1048576. << " of " << t->GetZipBytes() / 1048576. << " MB compressed), "
+         << bytesread / 1048576. << " MB read";
+    if (!ischain) cout << " in " << f->GetReadCalls() << " calls";
+    cout << endl;
+}
+
 void NanoAODAnalyzerrdframe::run(bool saveAll, string outtreename) {
 
     /*
@@ -1658,6 +1735,9 @@ void NanoAODAnalyzerrdframe::run(bool saveAll, string outtreename) {
     }
     */
 
+    // the event loops run here only, so a configuration can be checked (cache) after setupAnalysis without reading events
+    if (usePreselection()) setupPreselection();
+
     vector<RNodeTree *> rntends;
     _rnt.getRNodeLeafs(rntends);
     _rnt.Print();
@@ -1665,6 +1745,45 @@ void NanoAODAnalyzerrdframe::run(bool saveAll, string outtreename) {
     // on master, regex_replace doesn't work somehow
     //std::regex rootextension("\\.root");
 
+    // booked before the first Snapshot runs the event loop, so they are filled by the same loop
+    std::vector<RResultPtr<ULong64_t>> exports;
+    for (auto arnt: rntends) {
+        if (_exportcolumns.empty()) break;
+        RNode *arnode = arnt->getRNode();
+        std::string dir = _exportdir;
+        if (rntends.size()>1) dir += "_" + arnt->getIndex();
+        std::vector<std::string> names;
+        std::vector<std::string> types;
+        std::string row = "";
+        for (auto &pattern : _exportcolumns) {
+            std::regex b(pattern);
+            for (auto &a : arnode->GetColumnNames()) {
+                if (!std::regex_match(a, b) || std::find(names.begin(), names.end(), a) != names.end()) continue;
+                std::string type = arnode->GetColumnType(a);
+                if (type.find("RVec") != std::string::npos || type.find("vector") != std::string::npos) {
+                    cout << "WARNING! " << a << " is not a scalar (" << type << "), not exported" << endl;
+                    continue;
+                }
+                names.push_back(a);
+                types.push_back(type);
+                row += (row.empty() ? "float(" : ", float(") + a + ")";
+            }
+        }
+        auto out = std::make_shared<ColumnExport>(dir, names, types, _rd.GetNSlots());
+        if (names.empty() || !out->isValid()) {
+            cout << "WARNING! no column exported at " << arnt->getIndex() << endl;
+            continue;
+        }
+        exports.push_back(arnode->Define("columnexport_row", "ROOT::VecOps::RVec<float>({" + row + "})")
+                                 .Book<floats>(ColumnExportHelper(out), {"columnexport_row"}));
+    }
+
+    RSnapshotOptions snapshotopts;
+    if (_outcompression >= 0) {
+        snapshotopts.fCompressionAlgorithm = static_cast<RSnapshotOptions::ECAlgo>(_outcompression / 100);
+        snapshotopts.fCompressionLevel = _outcompression % 100;
+    }
+
     for (auto arnt: rntends) {
         string nodename = arnt->getIndex();
         //string outname = std::regex_replace(_outfilename, rootextension, "_"+nodename+".root");
@@ -1678,7 +1797,12 @@ void NanoAODAnalyzerrdframe::run(bool saveAll, string outtreename) {
         //cout << ROOT::RDF::SaveGraph(_rlm) << endl;
 
         if (saveAll) {
-            arnode->Snapshot(outtreename, outname);
+            // the working columns cannot be streamed
+            std::vector<std::string> allcolumns;
+            for (auto &a : arnode->GetColumnNames()) {
+                if (std::find(_workcolumns.begin(), _workcolumns.end(), a) == _workcolumns.end()) allcolumns.push_back(a);
+            }
+            arnode->Snapshot(outtreename, outname, allcolumns, snapshotopts);
         } else {
             // use the following if you want to store only a few variables
             //arnode->Snapshot(outtreename, outname, _varstostore);
@@ -1687,17 +1811,35 @@ void NanoAODAnalyzerrdframe::run(bool saveAll, string outtreename) {
                 cout << bname << ", ";
             }
             cout<<endl;
-            arnode->Snapshot(outtreename, outname, _varstostorepertree[nodename]);
+            arnode->Snapshot(outtreename, outname, _varstostorepertree[nodename], snapshotopts);
+        }
+        // filled by the first Snapshot
+        if (_pdfsums) {
+            for (size_t i=0; i<PDFWeights.size(); i++) PDFWeights[i] += (*_pdfsums)[i];
+            _pdfsums = RResultPtr<floats>();
         }
         _outrootfile = new TFile(outname.c_str(),"UPDATE");
+        std::vector<shapeentry> shapes;
         for (auto &h : _th1dhistos) {
-            if (h.second.GetPtr() != nullptr) {
-                h.second.GetPtr()->Print();
-                h.second.GetPtr()->Write();
-                //std::cout<<h.second->GetName()<<std::endl;
-                //h.second->Write();
-                //std::cout<<"Histogram is written"<<std::endl;
+            if (h.second.GetPtr() == nullptr) continue;
+            auto presel = _preselhistos.find(h.first);
+            TH1D *hist = presel != _preselhistos.end() ? presel->second.get() : h.second.GetPtr();
+            auto shape = _histshapes.find(h.first);
+            if (_densehistograms && shape != _histshapes.end()) {
+                shapes.push_back(shape->second);
+                shapes.back().h = hist;
+                continue;
             }
+            hist->Print();
+            hist->Write();
+            //std::cout<<h.second->GetName()<<std::endl;
+            //h.second->Write();
+            //std::cout<<"Histogram is written"<<std::endl;
+        }
+        if (!shapes.empty()) ShapeStore::write(_outrootfile, shapes);
+        if (!_quantized.empty()) {
+            TNamed codec(SFCodec::objectName, SFCodec::describe(_quantized).c_str());
+            codec.Write();
         }
 
         TH1F* hPDFWeights = new TH1F("LHEPdfWeightSum", "LHEPdfWeightSum", 103, 0, 103);
@@ -1707,4 +1849,8 @@ void NanoAODAnalyzerrdframe::run(bool saveAll, string outtreename) {
         _outrootfile->Write(0, TObject::kOverwrite);
         _outrootfile->Close();
     }
+    if (_sfclamped && *_sfclamped > 0) {
+        cout << "WARNING! " << *_sfclamped << " scale factor values outside the range of their 16 bit code were clamped" << endl;
+    }
+    reportInputRead();
 }
@@ -10,6 +10,7 @@
 
 #include "TTree.h"
 #include "TFile.h"
+#include "TEntryList.h"
 
 #include "ROOT/RDataFrame.hxx"
 #include "ROOT/RVec.hxx"
@@ -17,11 +18,14 @@
 #include "Math/Vector4D.h"
 #include "BTagCalibrationStandalone.h"
 #include "WeightCalculatorFromHistogram.h"
+#include "ScaleFactorTable.h"
 
 #include <string>
 #include "json/json.h"
 
 #include "utility.h" // floats, etc are defined here
+#include "ObjectCollection.h"
+#include "GenRecord.h"
 #include "RNodeTree.h"
 #include "JetCorrectorParameters.h"
 #include "FactorizedJetCorrector.h"
@@ -30,6 +34,11 @@
 #include "TauSFTool.h"
 
 #include "correction.h"
+#include "CorrectionAdapter.h"
+#include "EraPolicy.h"
+#include "DNNModel.h"
+#include "ShapeStore.h"
+#include "SFCodec.h"
 
 using namespace ROOT::RDF;
 
@@ -41,6 +50,19 @@ public:
   NanoAODAnalyzerrdframe(std::string infilename, std::string intreename, std::string outfilename, std::string year="", std::string syst="", std::string jsonfname="", string globaltag="", int nthreads=1);
   NanoAODAnalyzerrdframe(TTree *t, std::string outfilename, std::string year="", std::string syst="", std::string jsonfname="", string globaltag="", int nthreads=1);
   virtual ~NanoAODAnalyzerrdframe();
+  // process only entries [begin, end) of the input, call before setupAnalysis (single threaded only)
+  void setEntryRange(Long64_t begin, Long64_t end);
+  // two phase read: the entries passing preselection() are found first, reading only the branches it
+  // uses, then the full graph reads only those entries (baskets without any of them are not read)
+  void setLazyRead(bool lazyread) { _lazyread = lazyread; }
+  // necessary condition for the first cut, on input branches only; "" if there is none
+  virtual std::string preselection() const { return ""; }
+  // compression of the output trees as algorithm*100 + level (0: uncompressed), -1 for the Snapshot default
+  void setOutputCompression(int settings) { _outcompression = settings; }
+  // histograms stored per variable as TH3D (variation x cut step x bin) in shapes/, see ShapeStore
+  void setDenseHistograms(bool dense) { _densehistograms = dense; }
+  // stored scale factor columns written as 16 bit fixed point (SFCodec), decoded again when the skim is processed
+  void setQuantizedFactors(bool quantize) { _quantizefactors = quantize; }
   void setupAnalysis();
 
   // object selectors
@@ -48,6 +70,8 @@ public:
   bool readjson();
   void selectElectrons();
   void selectMuons();
+  // muons kept by selectMuons (muoncuts), also used by the preselection of SkimEvents
+  inline static const std::string muonSelection = "Muon_pt>50.0 && abs(Muon_eta)<2.4 && Muon_tightId && Muon_pfRelIso04_all<0.15";
   void selectJets(std::vector<std::string> jes_var);
   void skimJets();
   void applyBSFs(std::vector<string> jes_var);
@@ -68,15 +92,35 @@ public:
     _rlm = _rlm.Define(varname, function, columns);
   };
 
+  // classifier output 'node' of the network in modelfile, evaluated on the
+  // input columns named in the file; false if the model could not be loaded
+  bool addDNN(std::string varname, std::string modelfile, int node=1);
+
   void addVartoStore(std::string varname);
+  // also write the scalar columns matching these regular expressions as float32 .npy files (ColumnExport),
+  // in dir, default <output>_columns, with the node name appended when there are several output trees
+  void setColumnExport(std::vector<std::string> columns, std::string dir="");
+  const std::vector<std::string> &exportedColumns() const { return _exportcolumns; }
   void addCuts(std::string cut, std::string idx);
   virtual void defineCuts() = 0; // define a series of cuts from defined variables only. you must implement this in your subclassed analysis code
   void add1DHist(TH1DModel histdef, std::string variable, std::string weight, string syst="", string mincutstep="", string maxcutstep="");
   virtual void bookHists() = 0; // book histograms, you must implement this in your subclassed analysis code
 
   void setupCuts_and_Hists();
+  // text description of the configuration (cuts, variables, histograms, stored branches, ...), after setupAnalysis
+  std::string configurationSummary() const;
   void drawHists(RNode t);
+  // saveAll writes every column but the working columns of the selectors (workColumns)
   void run(bool saveAll=true, std::string outtreename="Events");
+  // output files written by run, one per output tree
+  const std::vector<std::string> &outputFiles() const { return _outrootfilenames; }
+  // columns used between the selectors only, of types without a dictionary (ObjectCollection, ...)
+  const std::vector<std::string> &workColumns() const { return _workcolumns; }
+  // input branches read by the booked graph, known after run (the TTreeReader adds them to the TTreeCache)
+  const std::vector<std::string> &inputBranches() const { return _inputbranches; }
+  // read only these branches, e.g. inputBranches() of an identical analyzer: disables the others
+  // and prefills a TTreeCache of one cluster of them; call before run
+  void setInputBranches(const std::vector<std::string> &branches);
   void setTree(TTree *t, std::string outfilename);
   void setupTree();
 
@@ -95,6 +139,7 @@ private:
   bool _isRun16 = false;
   bool _isRun17 = false;
   bool _isRun18 = false;
+  Era _era = Era::Unknown;
   // you MUST copy syst names from the output of 'python skimcsv.py'
   inline static std::vector<std::string> btag_var = {"central",
                 "hfup", "hfdown", "lfup", "lfdown", "hfstats1up", "hfstats1down",
@@ -114,13 +159,41 @@ private:
                 "jesRelativeBalup", "jesRelativeBaldown", "jesRelativeSample_2018up", "jesRelativeSample_2018down",
                 "jesHEMup", "jesHEMdown"};
   floats PDFWeights;
+  // sums of LHEPdfWeight booked by setupAnalysis, added to PDFWeights in run
+  RResultPtr<floats> _pdfsums;
   std::string _jsonfname;
   std::string _globaltag;
   TFile *_inrootfile;
   TFile *_outrootfile;
+  TTree *_intree;
+  Long64_t _entrybegin = 0;
+  Long64_t _entryend = -1;
+  bool _lazyread = false;
+  int _outcompression = -1;
+  bool _densehistograms = false;
+  bool _quantizefactors = false;
+  // columns quantized in the output, and the values clamped to their range
+  std::vector<sfcodecinfo> _quantized;
+  std::shared_ptr<std::atomic<ULong64_t>> _sfclamped;
+  // c from the c_q16 columns of a quantized skim, before anything reads c
+  void decodeQuantizedFactors();
+  std::unique_ptr<TEntryList> _preselected;
+  // histograms before the first cut, filled over all entries by the preselection loop
+  std::map<std::string, std::shared_ptr<TH1D>> _preselhistos;
+  bool usePreselection() const { return _lazyread && preselection() != ""; }
+  void setupPreselection();
+  std::vector<std::string> _inputbranches;
+  // bytes read from the input: per file counter for a single file, process wide for a chain
+  Long64_t inputBytesRead() const;
+  Long64_t _inputbytesstart = 0;
+  // logs the input branches and bytes read by the event loops of this analyzer
+  void reportInputRead();
   std::vector<std::string> _outrootfilenames;
+  std::vector<std::string> _workcolumns;
   RNode _rlm;
   std::map<std::string, RDF1DHist> _th1dhistos;
+  // variable, cut step and weight suffix of the histograms booked by setupCuts_and_Hists
+  std::map<std::string, shapeentry> _histshapes;
   //bool helper_1DHistCreator(std::string hname, std::string title, const int nbins, const double xlow, const double xhi, std::string rdfvar, std::string evWeight);
   void helper_1DHistCreator(std::string hname, std::string title, const int nbins, const double xlow, const double xhi, std::string rdfvar, std::string evWeight, RNode *anode);
   std::vector<std::string> _originalvars;
@@ -130,16 +203,33 @@ private:
   std::vector<varinfo> _varinfovector;
   std::vector<cutinfo> _cutinfovector;
 
+  struct dnninfo
+  {
+    std::string varname;
+    std::string modelfile;
+    std::shared_ptr<const DNNModel> model;
+    int node;
+  };
+  std::vector<dnninfo> _dnninfovector;
+
   std::vector<std::string> _varstostore;
+  std::vector<std::string> _exportcolumns;
+  std::string _exportdir;
   std::map<std::string, std::vector<std::string>> _varstostorepertree;
 
   Json::Value jsonroot;
 
+  // histogram based SF tables (muon, pileup), loaded once in setupAnalysis
+  ScaleFactorService _sfservice;
+
   RNodeTree _rnt;
   RNodeTree *currentnode;
   bool isDefined(string v);
 
   void setupJetMETCorrection(std::string globaltag, const std::vector<std::string> var = std::vector<std::string>(), std::string jetalgo="AK4PFchs", bool dataMc=false);
+  // JES/MET kernels for one EraPolicy, called through dispatchEra
+  template <typename Policy>
+  void defineJetMETCorrections(FactorizedJetCorrector *jetCorrector, std::vector<JetCorrectionUncertainty*> regroupedUnc, bool dataMc);
 
 };
 
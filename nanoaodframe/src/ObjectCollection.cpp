@@ -0,0 +1,145 @@
+/*
+ * ObjectCollection.cpp
+ *
+ *  Array based object collections with cached Cartesian components.
+ */
+
+#include "ObjectCollection.h"
+
+#include <algorithm>
+#include <cmath>
+
+ObjectCollection::ObjectCollection(const floats &pt, const floats &eta, const floats &phi, const floats &mass)
+:_pt(pt), _eta(eta), _phi(phi), _m(mass.size())
+{
+    for (size_t i=0; i<mass.size(); i++) _m[i] = std::fabs(mass[i]);
+}
+
+ObjectCollection::ObjectCollection(const FourVectorVec &p)
+:_pt(p.size()), _eta(p.size()), _phi(p.size()), _m(p.size())
+{
+    for (size_t i=0; i<p.size(); i++) {
+        _pt[i] = p[i].Pt();
+        _eta[i] = p[i].Eta();
+        _phi[i] = p[i].Phi();
+        _m[i] = p[i].M();
+    }
+}
+
+void ObjectCollection::cacheCartesian() const {
+
+    if (_cartesian) return;
+
+    const size_t n = _pt.size();
+    _px.resize(n);
+    _py.resize(n);
+    _pz.resize(n);
+    _e.resize(n);
+    _cosphi.resize(n);
+    _sinphi.resize(n);
+    for (size_t i=0; i<n; i++) {
+        _cosphi[i] = std::cos(_phi[i]);
+        _sinphi[i] = std::sin(_phi[i]);
+        _px[i] = _pt[i] * _cosphi[i];
+        _py[i] = _pt[i] * _sinphi[i];
+        _pz[i] = _pt[i] * std::sinh(_eta[i]);
+        _e[i] = std::sqrt(_px[i]*_px[i] + _py[i]*_py[i] + _pz[i]*_pz[i] + _m[i]*_m[i]);
+    }
+    _cartesian = true;
+}
+
+float ObjectCollection::deltaR2(size_t i, const ObjectCollection &other, size_t j) const {
+
+    float deta = _eta[i] - other._eta[j];
+    float dphi = wrapDeltaPhi(_phi[i] - other._phi[j]);
+    return deta*deta + dphi*dphi;
+}
+
+float ObjectCollection::deltaR(size_t i, const ObjectCollection &other, size_t j) const {
+    return std::sqrt(deltaR2(i, other, j));
+}
+
+float ObjectCollection::invMass(size_t i, const ObjectCollection &other, size_t j) const {
+
+    cacheCartesian();
+    other.cacheCartesian();
+    double e = _e[i] + other._e[j];
+    double px = _px[i] + other._px[j];
+    double py = _py[i] + other._py[j];
+    double pz = _pz[i] + other._pz[j];
+    double m2 = e*e - px*px - py*py - pz*pz;
+    return m2 > 0 ? std::sqrt(m2) : -std::sqrt(-m2);
+}
+
+ObjectCollection genCollection(floats &pt, floats &eta, floats &phi, floats &mass)
+{
+    return ObjectCollection(pt, eta, phi, mass);
+}
+
+ObjectCollection genCollectionFrom4vec(FourVectorVec &p)
+{
+    return ObjectCollection(p);
+}
+
+void deltaR2Matrix(const ObjectCollection &a, const ObjectCollection &b, floats &dr2)
+{
+    const size_t na = a.size();
+    const size_t nb = b.size();
+    dr2.resize(na * nb);
+
+    const float *beta = b.eta().data();
+    const float *bphi = b.phi().data();
+    // inner loop is branch free over contiguous arrays so it vectorizes
+    for (size_t i=0; i<na; i++) {
+        const float aeta = a.eta()[i];
+        const float aphi = a.phi()[i];
+        float *row = dr2.data() + i * nb;
+        for (size_t j=0; j<nb; j++) {
+            float deta = aeta - beta[j];
+            float dphi = wrapDeltaPhi(aphi - bphi[j]);
+            row[j] = deta*deta + dphi*dphi;
+        }
+    }
+}
+
+floats deltaR2Matrix(const ObjectCollection &a, const ObjectCollection &b)
+{
+    floats dr2;
+    deltaR2Matrix(a, b, dr2);
+    return dr2;
+}
+
+void overlapMask(const ObjectCollection &a, const ObjectCollection &b, float mindR, ints &mask)
+{
+    // b is scanned in fixed size blocks: branch free (vectorized) inside a
+    // block, stop after the first block with a close object
+    constexpr size_t blocksize = 8;
+    const float mindr2 = mindR * mindR;
+    const size_t na = a.size();
+    const size_t nb = b.size();
+    const float *beta = b.eta().data();
+    const float *bphi = b.phi().data();
+
+    mask.resize(na);
+    for (size_t i=0; i<na; i++) {
+        const float aeta = a.eta()[i];
+        const float aphi = a.phi()[i];
+        int close = 0;
+        for (size_t j0=0; j0<nb && !close; j0+=blocksize) {
+            const size_t jend = std::min(nb, j0 + blocksize);
+            for (size_t j=j0; j<jend; j++) {
+                float deta = aeta - beta[j];
+                float dphi = wrapDeltaPhi(aphi - bphi[j]);
+                close |= (deta*deta + dphi*dphi < mindr2);
+            }
+        }
+        mask[i] = !close;
+    }
+}
+
+ints overlapMask(const ObjectCollection &a, const ObjectCollection &b, float mindR)
+{
+    ints mask;
+    overlapMask(a, b, mindR, mask);
+    return mask;
+}
@@ -0,0 +1,83 @@
+/*
+ * ObjectCollection.h
+ *
+ *  Per-event collection of physics objects stored as arrays (pt, eta, phi, m).
+ *  The Cartesian components (px, py, pz, E) and cos/sin(phi) are computed
+ *  once, on first use, and kept with the collection, so that repeated
+ *  DeltaR / invariant mass evaluations (overlap removal, gen matching,
+ *  top reconstruction) do not redo the trigonometry of GenVector for every
+ *  access.
+ *  deltaR2Matrix fills the pairwise DeltaR^2 between two collections in one
+ *  flat, row-major array; overlapMask flags the objects of one collection
+ *  that are not close to any object of another.
+ */
+
+#ifndef OBJECTCOLLECTION_H_
+#define OBJECTCOLLECTION_H_
+
+#include <cmath>
+
+#include "utility.h"
+
+class ObjectCollection {
+public:
+    ObjectCollection() {}
+    // |mass| is used, as in gen4vec
+    ObjectCollection(const floats &pt, const floats &eta, const floats &phi, const floats &mass);
+    explicit ObjectCollection(const FourVectorVec &p);
+
+    size_t size() const { return _pt.size(); }
+    bool empty() const { return _pt.empty(); }
+
+    const floats &pt() const { return _pt; }
+    const floats &eta() const { return _eta; }
+    const floats &phi() const { return _phi; }
+    const floats &mass() const { return _m; }
+
+    // computed on first call
+    const floats &px() const { cacheCartesian(); return _px; }
+    const floats &py() const { cacheCartesian(); return _py; }
+    const floats &pz() const { cacheCartesian(); return _pz; }
+    const floats &e() const { cacheCartesian(); return _e; }
+    const floats &cosphi() const { cacheCartesian(); return _cosphi; }
+    const floats &sinphi() const { cacheCartesian(); return _sinphi; }
+
+    FourVector p4(size_t i) const { return FourVector(_pt[i], _eta[i], _phi[i], _m[i]); }
+
+    float deltaR2(size_t i, const ObjectCollection &other, size_t j) const;
+    float deltaR(size_t i, const ObjectCollection &other, size_t j) const;
+    float invMass(size_t i, const ObjectCollection &other, size_t j) const;
+
+private:
+    void cacheCartesian() const;
+
+    floats _pt, _eta, _phi, _m;
+    mutable floats _px, _py, _pz, _e, _cosphi, _sinphi;
+    mutable bool _cartesian = false;
+};
+
+using ObjectCollections = std::vector<ObjectCollection>;
+
+// RDataFrame helper, same inputs as gen4vec
+ObjectCollection genCollection(floats &pt, floats &eta, floats &phi, floats &mass);
+ObjectCollection genCollectionFrom4vec(FourVectorVec &p);
+
+// delta phi in [-pi, pi] for inputs in [-pi, pi]
+inline float wrapDeltaPhi(float dphi)
+{
+    constexpr float pi = M_PI;
+    dphi -= (dphi > pi) * (2.0f * pi);
+    dphi += (dphi <= -pi) * (2.0f * pi);
+    return dphi;
+}
+
+// dr2[i * b.size() + j] = DeltaR^2(a[i], b[j])
+void deltaR2Matrix(const ObjectCollection &a, const ObjectCollection &b, floats &dr2);
+floats deltaR2Matrix(const ObjectCollection &a, const ObjectCollection &b);
+
+// mask[i] = 1 if a[i] has DeltaR >= mindR to every object in b (also when b is empty), 0 otherwise
+// mask is resized to a.size(), no other memory is allocated
+void overlapMask(const ObjectCollection &a, const ObjectCollection &b, float mindR, ints &mask);
+ints overlapMask(const ObjectCollection &a, const ObjectCollection &b, float mindR);
+
+#endif /* OBJECTCOLLECTION_H_ */
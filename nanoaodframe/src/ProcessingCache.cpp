@@ -0,0 +1,115 @@
+/*
+ * ProcessingCache.cpp
+ *
+ *  Content addressed cache of partial outputs.
+ */
+
+#include "ProcessingCache.h"
+
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+ProcessingCache::ProcessingCache(std::string dir)
+:_dir(dir)
+{
+    // create the directory (and its parents) if needed
+    for (size_t pos = dir.find('/', 1); ; pos = dir.find('/', pos+1)) {
+        mkdir(dir.substr(0, pos).c_str(), 0755);
+        if (pos == std::string::npos) break;
+    }
+    struct stat st;
+    if (stat(_dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+        cout << "ERROR! ProcessingCache: cannot create directory " << _dir << endl;
+    }
+}
+
+uint64_t ProcessingCache::fnv1a(const char *data, size_t n, uint64_t h)
+{
+    for (size_t i=0; i<n; i++) {
+        h ^= (unsigned char)data[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+std::string ProcessingCache::hash(const std::string &text)
+{
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)fnv1a(text.data(), text.size(), 14695981039346656037ULL));
+    return hex;
+}
+
+std::string ProcessingCache::fileHash(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in.good()) return "";
+    uint64_t h = 14695981039346656037ULL;
+    char buffer[1 << 16];
+    while (in.read(buffer, sizeof(buffer)) || in.gcount() > 0) h = fnv1a(buffer, in.gcount(), h);
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)h);
+    return hex;
+}
+
+const std::string &ProcessingCache::buildId()
+{
+    static const std::string id = []() {
+        // the shared object (or executable) that contains this function
+        Dl_info info;
+        std::string binary = "";
+        if (dladdr((void *)&ProcessingCache::fnv1a, &info) != 0 && info.dli_fname != nullptr) binary = info.dli_fname;
+        std::string h = binary != "" ? fileHash(binary) : "";
+        if (h == "") {
+            cout << "WARNING! ProcessingCache: cannot hash the binary, using the compilation time as build id" << endl;
+            h = hash(std::string(__DATE__) + " " + __TIME__);
+        }
+        return h;
+    }();
+    return id;
+}
+
+std::string ProcessingCache::key(const std::string &inputid, const std::string &configuration) const
+{
+    return hash(inputid + "\n" + configuration + "\n" + buildId());
+}
+
+bool ProcessingCache::copyFile(const std::string &src, const std::string &dest)
+{
+    // same file system: a hard link is enough
+    unlink(dest.c_str());
+    if (link(src.c_str(), dest.c_str()) == 0) return true;
+
+    std::ifstream in(src, std::ios::binary);
+    std::ofstream out(dest, std::ios::binary | std::ios::trunc);
+    if (!in.good() || !out.good()) return false;
+    out << in.rdbuf();
+    return out.good();
+}
+
+bool ProcessingCache::fetch(const std::string &key, const std::string &dest) const
+{
+    struct stat st;
+    if (stat(path(key).c_str(), &st) != 0) return false;
+    return copyFile(path(key), dest);
+}
+
+bool ProcessingCache::store(const std::string &key, const std::string &src) const
+{
+    std::ostringstream tmp;
+    tmp << path(key) << ".tmp" << getpid() << "_" << std::hash<std::string>()(src);
+    if (!copyFile(src, tmp.str()) || rename(tmp.str().c_str(), path(key).c_str()) != 0) {
+        unlink(tmp.str().c_str());
+        cout << "WARNING! ProcessingCache: cannot store " << src << " in " << _dir << endl;
+        return false;
+    }
+    return true;
+}
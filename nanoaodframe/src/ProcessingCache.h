@@ -0,0 +1,47 @@
+/*
+ * ProcessingCache.h
+ *
+ *  Content addressed store of partial outputs (the file one analyzer writes
+ *  for one entry range of one input). The key hashes
+ *   - the input identity (path, TFile UUID, entries, entry range)
+ *   - the analyzer configuration (NanoAODAnalyzerrdframe::configurationSummary:
+ *     cuts, variables, histogram models, stored branches, year, syst, ...)
+ *   - the build id (hash of the binary holding this code)
+ *  so a rerun only processes the inputs whose key is not in the cache yet.
+ *  Lambda bodies and data files (SFs, corrections) are not part of the
+ *  configuration: they are covered by the build id and by the file path only.
+ */
+
+#ifndef PROCESSINGCACHE_H_
+#define PROCESSINGCACHE_H_
+
+#include <cstdint>
+#include <string>
+
+class ProcessingCache {
+public:
+    ProcessingCache(std::string dir);
+
+    // 64 bit FNV-1a hash, as 16 hex digits
+    static std::string hash(const std::string &text);
+    // hash of the content of a file, "" if it cannot be read
+    static std::string fileHash(const std::string &path);
+    // hash of the executable or library this code is linked into, computed once
+    static const std::string &buildId();
+
+    std::string key(const std::string &inputid, const std::string &configuration) const;
+    std::string path(const std::string &key) const { return _dir + "/" + key + ".root"; }
+
+    // copies the cached partial to dest, false if not cached
+    bool fetch(const std::string &key, const std::string &dest) const;
+    // adds src to the cache (written to a temporary name and renamed, so readers never see half a file)
+    bool store(const std::string &key, const std::string &src) const;
+
+private:
+    static uint64_t fnv1a(const char *data, size_t n, uint64_t h);
+    static bool copyFile(const std::string &src, const std::string &dest);
+
+    std::string _dir;
+};
+
+#endif /* PROCESSINGCACHE_H_ */
@@ -0,0 +1,124 @@
+/*
+ * SFCodec.cpp
+ *
+ *  16 bit fixed point scale factor columns.
+ */
+
+#include "SFCodec.h"
+
+#include <cmath>
+#include <iostream>
+#include <sstream>
+
+#include "TNamed.h"
+
+using namespace std;
+
+const std::vector<sfcodecinfo> &SFCodec::defaultColumns()
+{
+    // the range 1 +- 32767 * precision must hold the factors: pileup weights go up to ~10,
+    // tau anti-lepton SFs up to ~2, JER factors of badly matched jets above 2
+    static const std::vector<sfcodecinfo> columns = {
+        {"puWeight", 5e-4, false},          // [0, 17.4]
+        {"muonWeightId", 1e-5, false},      // [0.67, 1.33]
+        {"muonWeightIso", 1e-5, false},
+        {"muonWeightTrg", 1e-5, false},
+        {"tauWeightIdVsJet", 1e-4, false},  // [0, 4.28]
+        {"tauWeightIdVsEl", 1e-4, false},
+        {"tauWeightIdVsMu", 1e-4, false},
+        {"Jet_pt_unc", 2e-5, false},        // [0.34, 1.66]
+        {"Jet_jer", 5e-5, false},           // [0, 2.64]
+    };
+    return columns;
+}
+
+short SFCodec::encode(float x, float precision, std::atomic<ULong64_t> &nclamped)
+{
+    if (std::isnan(x)) {
+        nclamped++;
+        return 0;
+    }
+    const float q = std::round((x - 1.0f) / precision);
+    if (q > maxCode || q < -maxCode) {
+        nclamped++;
+        return q > 0 ? maxCode : -maxCode;
+    }
+    return static_cast<short>(q);
+}
+
+shorts SFCodec::encode(const floats &x, float precision, std::atomic<ULong64_t> &nclamped)
+{
+    shorts out(x.size());
+    for (size_t i=0; i<x.size(); i++) out[i] = encode(x[i], precision, nclamped);
+    return out;
+}
+
+shorts SFCodec::encodeFlat(const floatsVec &x, float precision, std::atomic<ULong64_t> &nclamped)
+{
+    size_t n = 0;
+    for (auto &v : x) n += v.size();
+    shorts out;
+    out.reserve(n);
+    for (auto &v : x) {
+        for (auto f : v) out.push_back(encode(f, precision, nclamped));
+    }
+    return out;
+}
+
+ints SFCodec::sizes(const floatsVec &x)
+{
+    ints out(x.size());
+    for (size_t i=0; i<x.size(); i++) out[i] = x[i].size();
+    return out;
+}
+
+floats SFCodec::decode(const shorts &q, float precision)
+{
+    floats out(q.size());
+    for (size_t i=0; i<q.size(); i++) out[i] = decode(q[i], precision);
+    return out;
+}
+
+floatsVec SFCodec::decode(const shorts &q, const ints &sizes, float precision)
+{
+    floatsVec out(sizes.size());
+    size_t k = 0;
+    for (size_t i=0; i<sizes.size(); i++) {
+        out[i].reserve(sizes[i]);
+        // values missing from a truncated q read as 1
+        for (int j=0; j<sizes[i]; j++, k++) out[i].push_back(k < q.size() ? decode(q[k], precision) : 1.0f);
+    }
+    return out;
+}
+
+std::string SFCodec::describe(const std::vector<sfcodecinfo> &columns)
+{
+    std::ostringstream out;
+    for (auto &c : columns) out << c.column << " " << c.precision << " " << c.nested << "\n";
+    return out.str();
+}
+
+std::vector<sfcodecinfo> SFCodec::parse(const std::string &text)
+{
+    std::vector<sfcodecinfo> columns;
+    std::istringstream in(text);
+    for (std::string line; std::getline(in, line);) {
+        std::istringstream fields(line);
+        sfcodecinfo c;
+        if (!(fields >> c.column >> c.precision >> c.nested) || c.precision <= 0) {
+            if (line != "") cout << "WARNING! SFCodec: cannot parse \"" << line << "\"" << endl;
+            continue;
+        }
+        columns.push_back(c);
+    }
+    return columns;
+}
+
+std::vector<sfcodecinfo> SFCodec::read(TFile *f)
+{
+    TNamed *desc = f != nullptr ? f->Get<TNamed>(objectName) : nullptr;
+    if (desc == nullptr) return {};
+    auto columns = parse(desc->GetTitle());
+    delete desc;
+    return columns;
+}
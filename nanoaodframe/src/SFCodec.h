@@ -0,0 +1,65 @@
+/*
+ * SFCodec.h
+ *
+ *  16 bit fixed point storage of the scale factor columns of the skims
+ *  (puWeight, muonWeight*, tauWeightIdVs*, Jet_pt_unc, Jet_jer), which
+ *  are all close to 1 and take most of the skim size after the GenPart
+ *  and Jet branches:
+ *   - a factor x of column c is stored as the short
+ *     q = round((x - 1) / precision(c)) in c_q16, so the value read back,
+ *     1 + q * precision(c), differs from x by at most precision(c)/2
+ *   - q is clamped to +-32767: values outside 1 +- 32767 * precision(c)
+ *     are stored as the nearest end of the range and counted
+ *   - RVec<RVec<float>> columns (per jet or tau) are stored flat, with the
+ *     number of values of every jet or tau in c_q16n
+ *  The precisions of the written columns are stored in the skim as the
+ *  TNamed "sfcodec" (one "column precision nested" line per column), and
+ *  the processing decodes the c_q16 columns found in its input back to c.
+ */
+
+#ifndef SFCODEC_H_
+#define SFCODEC_H_
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "TFile.h"
+
+#include "utility.h"
+
+struct sfcodecinfo
+{
+    std::string column;
+    float precision;
+    // RVec<RVec<float>> stored flat with the inner sizes
+    bool nested;
+};
+
+class SFCodec {
+public:
+    static constexpr const char *objectName = "sfcodec";
+    static constexpr short maxCode = 32767;
+
+    // the columns quantized by the skims and their declared precision (nested is set from the column type)
+    static const std::vector<sfcodecinfo> &defaultColumns();
+    static std::string encodedName(const std::string &column) { return column + "_q16"; }
+    static std::string sizesName(const std::string &column) { return column + "_q16n"; }
+
+    // nclamped counts the values outside the range (and NaN, stored as 1)
+    static short encode(float x, float precision, std::atomic<ULong64_t> &nclamped);
+    static float decode(short q, float precision) { return 1.0f + q * precision; }
+    static shorts encode(const floats &x, float precision, std::atomic<ULong64_t> &nclamped);
+    static shorts encodeFlat(const floatsVec &x, float precision, std::atomic<ULong64_t> &nclamped);
+    static ints sizes(const floatsVec &x);
+    static floats decode(const shorts &q, float precision);
+    static floatsVec decode(const shorts &q, const ints &sizes, float precision);
+
+    // text of the "sfcodec" object and back
+    static std::string describe(const std::vector<sfcodecinfo> &columns);
+    static std::vector<sfcodecinfo> parse(const std::string &text);
+    // columns described in f, empty if it has no "sfcodec"
+    static std::vector<sfcodecinfo> read(TFile *f);
+};
+
+#endif /* SFCODEC_H_ */
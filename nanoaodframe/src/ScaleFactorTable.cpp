@@ -0,0 +1,128 @@
+/*
+ * ScaleFactorTable.cpp
+ *
+ *  Flat, read-only lookup tables for histogram based scale factors.
+ */
+
+#include "ScaleFactorTable.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "TFile.h"
+
+using namespace std;
+
+ScaleFactorTable::ScaleFactorTable(const TH1 *hist, bool clamp)
+:_clamp(clamp)
+{
+    if (hist == nullptr) {
+        cout << "ERROR! ScaleFactorTable: input histogram is not loaded!" << endl;
+        return;
+    }
+    loadEdges(hist);
+    _cells.resize(hist->GetNcells());
+    for (int i=0; i<hist->GetNcells(); i++) {
+        float sf = hist->GetBinContent(i);
+        float err = hist->GetBinError(i);
+        _cells[i] = {sf, sf + err, sf - err};
+    }
+}
+
+ScaleFactorTable::ScaleFactorTable(const TH1 *hnom, const TH1 *hup, const TH1 *hdown, bool clamp)
+:_clamp(clamp)
+{
+    if (hnom == nullptr || hup == nullptr || hdown == nullptr) {
+        cout << "ERROR! ScaleFactorTable: input histograms are not loaded!" << endl;
+        return;
+    }
+    if (hnom->GetNcells() != hup->GetNcells() || hnom->GetNcells() != hdown->GetNcells()) {
+        cout << "ERROR! ScaleFactorTable: nominal and variation histograms have different number of bins!" << endl;
+        return;
+    }
+    loadEdges(hnom);
+    _cells.resize(hnom->GetNcells());
+    for (int i=0; i<hnom->GetNcells(); i++) {
+        _cells[i] = {float(hnom->GetBinContent(i)), float(hup->GetBinContent(i)), float(hdown->GetBinContent(i))};
+    }
+}
+
+void ScaleFactorTable::loadEdges(const TH1 *hist) {
+
+    auto axisEdges = [](const TAxis *axis, std::vector<double> &edges) {
+        edges.clear();
+        for (int i=1; i<=axis->GetNbins(); i++) edges.push_back(axis->GetBinLowEdge(i));
+        edges.push_back(axis->GetBinUpEdge(axis->GetNbins()));
+    };
+
+    _nx = hist->GetNbinsX();
+    axisEdges(hist->GetXaxis(), _xedges);
+    if (hist->GetDimension() > 1) {
+        _ny = hist->GetNbinsY();
+        axisEdges(hist->GetYaxis(), _yedges);
+    }
+}
+
+// same numbering as TAxis::FindBin: 0 underflow, 1..nbins, nbins+1 overflow
+int ScaleFactorTable::findBin(const std::vector<double> &edges, int nbins, float v) const {
+
+    int bin = std::upper_bound(edges.begin(), edges.end(), double(v)) - edges.begin();
+    if (_clamp) bin = std::max(1, std::min(nbins, bin));
+    return bin;
+}
+
+sfvalues ScaleFactorTable::get(float x, float y) const {
+
+    if (_nx == 0) return {1.0, 1.0, 1.0};
+
+    int bin = findBin(_xedges, _nx, x);
+    if (_ny > 0) bin += (_nx + 2) * findBin(_yedges, _ny, y);
+    return _cells[bin];
+}
+
+void ScaleFactorTable::get(const floats &x, const floats &y, floats &out) const {
+
+    out.reserve(out.size() + 3*x.size());
+    for (size_t i=0; i<x.size(); i++) {
+        sfvalues sf = get(x[i], i < y.size() ? y[i] : 0.0f);
+        out.push_back(sf.nom);
+        out.push_back(sf.up);
+        out.push_back(sf.down);
+    }
+}
+
+ScaleFactorService::TablePtr ScaleFactorService::add(const std::string &name, ScaleFactorTable table) {
+
+    if (!table.isValid())
+        cout << "WARNING! Scale factor table " << name << " is empty, lookups will return 1" << endl;
+    TablePtr ptr = std::make_shared<const ScaleFactorTable>(std::move(table));
+    _tables[name] = ptr;
+    return ptr;
+}
+
+ScaleFactorService::TablePtr ScaleFactorService::load(const std::string &name, const std::string &filename, const std::string &histname, bool clamp) {
+
+    TFile *f = TFile::Open(filename.c_str());
+    if (f == nullptr || f->IsZombie()) {
+        cout << "ERROR! Cannot open scale factor file " << filename << endl;
+        return add(name, ScaleFactorTable());
+    }
+    TH1 *hist = dynamic_cast<TH1 *>(f->Get(histname.c_str()));
+    if (hist == nullptr)
+        cout << "ERROR! Histogram " << histname << " not found in " << filename << endl;
+    // the table copies everything it needs, the histogram can go with the file
+    TablePtr ptr = add(name, ScaleFactorTable(hist, clamp));
+    f->Close();
+    delete f;
+    return ptr;
+}
+
+ScaleFactorService::TablePtr ScaleFactorService::get(const std::string &name) const {
+
+    auto it = _tables.find(name);
+    if (it == _tables.end()) {
+        cout << "ERROR! Scale factor table " << name << " was not loaded" << endl;
+        return nullptr;
+    }
+    return it->second;
+}
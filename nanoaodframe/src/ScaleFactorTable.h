@@ -0,0 +1,78 @@
+/*
+ * ScaleFactorTable.h
+ *
+ *  Flat, read-only lookup tables for histogram based scale factors
+ *  (muon ID/ISO/trigger, pileup, binned tau ID SFs).
+ *  Histograms are unpacked once at setup into plain arrays of bin edges
+ *  and (nominal, up, down) triplets, so that a lookup is a binary search
+ *  plus one memory access and can be shared between RDataFrame slots
+ *  without locking.
+ */
+
+#ifndef SCALEFACTORTABLE_H_
+#define SCALEFACTORTABLE_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TH1.h"
+#include "utility.h"
+
+// nominal, up and down value of one lookup
+struct sfvalues
+{
+    float nom;
+    float up;
+    float down;
+};
+
+class ScaleFactorTable {
+public:
+    ScaleFactorTable() {}
+    // nominal from the bin content, up/down from content +- bin error
+    ScaleFactorTable(const TH1 *hist, bool clamp=true);
+    // nominal, up and down from three histograms with identical binning
+    ScaleFactorTable(const TH1 *hnom, const TH1 *hup, const TH1 *hdown, bool clamp=true);
+
+    // clamp=true  : out-of-range values use the first/last bin (WeightCalculatorFromHistogram)
+    // clamp=false : out-of-range values use under/overflow cells (TH1::FindBin)
+    sfvalues get(float x, float y=0) const;
+    float getNominal(float x, float y=0) const { return get(x, y).nom; }
+
+    // batched lookup, appends nom, up, down for every (x[i], y[i]) to out
+    void get(const floats &x, const floats &y, floats &out) const;
+
+    bool isValid() const { return _nx > 0; }
+    bool is2D() const { return _ny > 0; }
+
+private:
+    void loadEdges(const TH1 *hist);
+    int findBin(const std::vector<double> &edges, int nbins, float v) const;
+
+    int _nx = 0;
+    int _ny = 0;
+    bool _clamp = true;
+    std::vector<double> _xedges;
+    std::vector<double> _yedges;
+    // one entry per histogram cell, same global bin numbering as ROOT
+    std::vector<sfvalues> _cells;
+};
+
+// Named collection of tables built during setupAnalysis.
+// Tables are immutable once added, the lambdas capture the shared pointers.
+class ScaleFactorService {
+public:
+    using TablePtr = std::shared_ptr<const ScaleFactorTable>;
+
+    TablePtr add(const std::string &name, ScaleFactorTable table);
+    // read histname from filename, variations from bin errors
+    TablePtr load(const std::string &name, const std::string &filename, const std::string &histname, bool clamp=true);
+    TablePtr get(const std::string &name) const;
+
+private:
+    std::map<std::string, TablePtr> _tables;
+};
+
+#endif /* SCALEFACTORTABLE_H_ */
@@ -0,0 +1,199 @@
+/*
+ * ShapeStore.cpp
+ *
+ *  One TH3D per variable instead of one TH1D per histogram.
+ */
+
+#include "ShapeStore.h"
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+
+#include "TKey.h"
+
+using namespace std;
+
+namespace {
+// bin labels of the nominal weight and of the histograms before the first cut
+const std::string kNominal = "nominal";
+const std::string kAllEvents = "all";
+
+bool sameBinning(const TAxis *a, const TAxis *b)
+{
+    if (a->GetNbins() != b->GetNbins()) return false;
+    for (int i=1; i<=a->GetNbins()+1; i++) {
+        if (a->GetBinLowEdge(i) != b->GetBinLowEdge(i)) return false;
+    }
+    return true;
+}
+
+size_t indexOf(std::vector<std::string> &labels, const std::string &label)
+{
+    auto it = std::find(labels.begin(), labels.end(), label);
+    if (it != labels.end()) return it - labels.begin();
+    labels.push_back(label);
+    return labels.size() - 1;
+}
+}
+
+std::string ShapeStore::histName(const std::string &variable, const std::string &step, const std::string &syst)
+{
+    return variable + (step == "" ? "" : "_" + step) + syst;
+}
+
+int ShapeStore::write(TDirectory *dir, const std::vector<shapeentry> &entries)
+{
+    // variables in the order of their first histogram
+    std::vector<std::string> variables;
+    std::map<std::string, std::vector<const shapeentry *>> groups;
+    std::vector<const TH1D *> single;
+    for (auto &e : entries) {
+        if (e.h == nullptr) continue;
+        auto &group = groups[e.variable];
+        if (group.empty()) variables.push_back(e.variable);
+        else if (!sameBinning(group[0]->h->GetXaxis(), e.h->GetXaxis()) || std::string(group[0]->h->GetTitle()) != e.h->GetTitle()) {
+            single.push_back(e.h);
+            continue;
+        }
+        group.push_back(&e);
+    }
+
+    TDirectory *shapes = dir->GetDirectory(dirName);
+    if (shapes == nullptr) shapes = dir->mkdir(dirName);
+    if (shapes == nullptr) {
+        cout << "ERROR! ShapeStore: cannot create " << dirName << " in " << dir->GetName() << endl;
+        return 0;
+    }
+    int nkeys = 0;
+    for (auto &variable : variables) {
+        auto &group = groups[variable];
+        std::vector<std::string> systs;
+        std::vector<std::string> steps;
+        std::vector<std::pair<int, int>> bins;
+        for (auto e : group) {
+            int ix = indexOf(systs, e->syst == "" ? kNominal : e->syst) + 1;
+            int iy = indexOf(steps, e->step == "" ? kAllEvents : e->step) + 1;
+            bins.push_back({ix, iy});
+        }
+        const int nx = systs.size();
+        const int ny = steps.size();
+        const TH1D *first = group[0]->h;
+        const TAxis *axis = first->GetXaxis();
+        const int nz = axis->GetNbins();
+        std::unique_ptr<TH3D> shape;
+        if (axis->GetXbins()->GetSize() == 0) {
+            shape.reset(new TH3D(variable.c_str(), first->GetTitle(), nx, 0, nx, ny, 0, ny, nz, axis->GetXmin(), axis->GetXmax()));
+        } else {
+            std::vector<double> xedges(nx+1), yedges(ny+1);
+            std::iota(xedges.begin(), xedges.end(), 0.0);
+            std::iota(yedges.begin(), yedges.end(), 0.0);
+            shape.reset(new TH3D(variable.c_str(), first->GetTitle(), nx, xedges.data(), ny, yedges.data(), nz, axis->GetXbins()->GetArray()));
+        }
+        std::unique_ptr<TH2D> nentries(new TH2D((variable + "_entries").c_str(), "", nx, 0, nx, ny, 0, ny));
+        shape->SetDirectory(nullptr);
+        nentries->SetDirectory(nullptr);
+        shape->Sumw2();
+        for (int ix=1; ix<=nx; ix++) {
+            shape->GetXaxis()->SetBinLabel(ix, systs[ix-1].c_str());
+            nentries->GetXaxis()->SetBinLabel(ix, systs[ix-1].c_str());
+        }
+        for (int iy=1; iy<=ny; iy++) {
+            shape->GetYaxis()->SetBinLabel(iy, steps[iy-1].c_str());
+            nentries->GetYaxis()->SetBinLabel(iy, steps[iy-1].c_str());
+        }
+        // -1 entries for the variations and steps the variable is not booked for (still < 0 after merging files)
+        for (int ix=1; ix<=nx; ix++) {
+            for (int iy=1; iy<=ny; iy++) nentries->SetBinContent(ix, iy, -1);
+        }
+        for (size_t i=0; i<group.size(); i++) {
+            const TH1D *h = group[i]->h;
+            for (int iz=0; iz<=nz+1; iz++) {
+                shape->SetBinContent(bins[i].first, bins[i].second, iz, h->GetBinContent(iz));
+                shape->SetBinError(bins[i].first, bins[i].second, iz, h->GetBinError(iz));
+            }
+            nentries->SetBinContent(bins[i].first, bins[i].second, h->GetEntries());
+        }
+        shape->ResetStats();
+        shapes->WriteTObject(shape.get(), nullptr, "Overwrite");
+        shapes->WriteTObject(nentries.get(), nullptr, "Overwrite");
+        nkeys += 2;
+    }
+    for (auto h : single) {
+        dir->WriteTObject(h, nullptr, "Overwrite");
+        nkeys++;
+    }
+    cout << "ShapeStore: " << entries.size() << " histograms of " << variables.size() << " variables in " << nkeys << " keys" << endl;
+    return nkeys;
+}
+
+ShapeStore::ShapeStore(TFile *f)
+{
+    TDirectory *shapes = f != nullptr ? f->GetDirectory(dirName) : nullptr;
+    if (shapes == nullptr) return;
+    for (auto obj : *shapes->GetListOfKeys()) {
+        TKey *key = static_cast<TKey *>(obj);
+        if (std::string(key->GetClassName()) != "TH3D") continue;
+        const std::string variable = key->GetName();
+        // older cycles of the same variable
+        if (std::any_of(_shapes.begin(), _shapes.end(), [&](const std::unique_ptr<TH3D> &s) { return variable == s->GetName(); })) continue;
+        TH3D *shape = shapes->Get<TH3D>(variable.c_str());
+        TH2D *nentries = shapes->Get<TH2D>((variable + "_entries").c_str());
+        if (shape == nullptr) continue;
+        shape->SetDirectory(nullptr);
+        _shapes.emplace_back(shape);
+        if (nentries != nullptr) {
+            nentries->SetDirectory(nullptr);
+            _entries.emplace_back(nentries);
+        }
+        for (int ix=1; ix<=shape->GetNbinsX(); ix++) {
+            std::string syst = shape->GetXaxis()->GetBinLabel(ix);
+            if (syst == kNominal) syst = "";
+            for (int iy=1; iy<=shape->GetNbinsY(); iy++) {
+                std::string step = shape->GetYaxis()->GetBinLabel(iy);
+                if (step == kAllEvents) step = "";
+                if (nentries != nullptr && nentries->GetBinContent(ix, iy) < 0) continue;
+                _index[histName(variable, step, syst)] = {shape, nentries, ix, iy};
+            }
+        }
+    }
+}
+
+std::vector<std::string> ShapeStore::names() const
+{
+    std::vector<std::string> result;
+    for (auto &i : _index) result.push_back(i.first);
+    return result;
+}
+
+TH1D *ShapeStore::get(const std::string &name) const
+{
+    auto it = _index.find(name);
+    if (it == _index.end()) return nullptr;
+    const location &l = it->second;
+    const TAxis *axis = l.shape->GetZaxis();
+    const int nz = axis->GetNbins();
+    TH1D *h = axis->GetXbins()->GetSize() == 0
+              ? new TH1D(name.c_str(), l.shape->GetTitle(), nz, axis->GetXmin(), axis->GetXmax())
+              : new TH1D(name.c_str(), l.shape->GetTitle(), nz, axis->GetXbins()->GetArray());
+    h->SetDirectory(nullptr);
+    h->Sumw2();
+    for (int iz=0; iz<=nz+1; iz++) {
+        h->SetBinContent(iz, l.shape->GetBinContent(l.ivar, l.istep, iz));
+        h->SetBinError(iz, l.shape->GetBinError(l.ivar, l.istep, iz));
+    }
+    h->ResetStats();
+    if (l.entries != nullptr) h->SetEntries(l.entries->GetBinContent(l.ivar, l.istep));
+    return h;
+}
+
+int ShapeStore::expand(TDirectory *dir) const
+{
+    int n = 0;
+    for (auto &i : _index) {
+        std::unique_ptr<TH1D> h(get(i.first));
+        dir->WriteTObject(h.get(), nullptr, "Overwrite");
+        n++;
+    }
+    return n;
+}
@@ -0,0 +1,74 @@
+/*
+ * ShapeStore.h
+ *
+ *  Dense layout of the output histograms: instead of one TH1D key per
+ *  variable, cut step and systematic weight (h_<var>_S<n><syst>), every
+ *  variable is stored once in the directory "shapes" as
+ *   - a TH3D <var>: x = variation (bin labels, "nominal" for no suffix),
+ *     y = cut step (bin labels S<n>, "all" before the first cut),
+ *     z = the bins of the variable, with under- and overflow
+ *   - a TH2D <var>_entries with the number of entries of every histogram,
+ *     negative for the variations and steps the variable is not booked for
+ *  so writing and reading a file takes one key per variable.
+ *  Histograms of a variable with a different binning or title than the
+ *  first one are written as they are.
+ *  A ShapeStore opened on a file serves the histograms under their old
+ *  names from the TH3Ds (get), and expand() writes them back as
+ *  individual keys for tools that read the old layout.
+ */
+
+#ifndef SHAPESTORE_H_
+#define SHAPESTORE_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TDirectory.h"
+#include "TFile.h"
+#include "TH1D.h"
+#include "TH2D.h"
+#include "TH3D.h"
+
+struct shapeentry
+{
+    std::string variable;
+    // "" before the first cut, S<n> after cut n
+    std::string step;
+    // weight suffix, "" for the nominal weight
+    std::string syst;
+    const TH1D *h;
+};
+
+class ShapeStore {
+public:
+    static constexpr const char *dirName = "shapes";
+    // the name of the individual histogram
+    static std::string histName(const std::string &variable, const std::string &step, const std::string &syst);
+    // writes entries into dir/shapes, grouped by variable; returns the number of keys written
+    static int write(TDirectory *dir, const std::vector<shapeentry> &entries);
+
+    // index of the shapes of f, empty if f has none
+    ShapeStore(TFile *f);
+    bool isValid() const { return !_index.empty(); }
+    std::vector<std::string> names() const;
+    // new histogram with the old name, not attached to a directory; nullptr if not stored
+    TH1D *get(const std::string &name) const;
+    // writes every histogram into dir under its old name; returns how many
+    int expand(TDirectory *dir) const;
+
+private:
+    struct location
+    {
+        const TH3D *shape;
+        const TH2D *entries;
+        int ivar;
+        int istep;
+    };
+    std::vector<std::unique_ptr<TH3D>> _shapes;
+    std::vector<std::unique_ptr<TH2D>> _entries;
+    std::map<std::string, location> _index;
+};
+
+#endif /* SHAPESTORE_H_ */
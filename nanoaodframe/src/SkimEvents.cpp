@@ -18,18 +18,41 @@ SkimEvents::SkimEvents(TTree *t, std::string outfilename, std::string year, std:
   }
 }
 
+// Single muon trigger of the year
+std::string SkimEvents::triggerSelection() const
+{
+  if (_year.find("16") != std::string::npos) return "(HLT_IsoMu24 || HLT_IsoTkMu24)";
+  if (_year.find("17") != std::string::npos) return "HLT_IsoMu27";
+  if (_year.find("18") != std::string::npos) return "HLT_IsoMu24";
+  return "";
+}
+
+// MET filters of the year
+std::string SkimEvents::flagSelection() const
+{
+  if(_year.find("16") != std::string::npos){
+      return "Flag_goodVertices && Flag_globalSuperTightHalo2016Filter && Flag_HBHENoiseFilter && Flag_HBHENoiseIsoFilter && Flag_EcalDeadCellTriggerPrimitiveFilter && Flag_BadPFMuonFilter && Flag_BadPFMuonDzFilter && Flag_eeBadScFilter && Flag_hfNoisyHitsFilter";
+  }
+  // For 17, 18 UL
+  return "Flag_goodVertices && Flag_globalSuperTightHalo2016Filter && Flag_HBHENoiseFilter && Flag_HBHENoiseIsoFilter && Flag_EcalDeadCellTriggerPrimitiveFilter && Flag_BadPFMuonFilter && Flag_BadPFMuonDzFilter && Flag_hfNoisyHitsFilter && Flag_eeBadScFilter && Flag_ecalBadCalibFilter";
+}
+
+// The first cut on input branches only: flags, trigger and exactly one selected muon
+std::string SkimEvents::preselection() const
+{
+  if (triggerSelection() == "") return "";
+  return "(" + flagSelection() + ") && " + triggerSelection() + " && Sum(" + muonSelection + ") == 1 && PV_npvsGood > 0";
+}
+
 // Define your cuts here
 void SkimEvents::defineCuts()
 {
   // Cuts to be applied in order
   // These will be passed to Filter method of RDF
   // check for good json event is defined earlier
-  if (_year.find("16") != std::string::npos) {
-      addCuts("Flag_filter && (HLT_IsoMu24 || HLT_IsoTkMu24) && nmuonpass == 1 && PV_npvsGood > 0","0");
-  } else if (_year.find("17") != std::string::npos) {
-      addCuts("Flag_filter && HLT_IsoMu27 && nmuonpass == 1 && PV_npvsGood > 0","0");
-  } else if (_year.find("18") != std::string::npos) {
-      addCuts("Flag_filter && HLT_IsoMu24 && nmuonpass == 1 && PV_npvsGood > 0","0");
+  // preselection() must stay a necessary condition of cut "0"
+  if (triggerSelection() != "") {
+      addCuts("Flag_filter && " + triggerSelection() + " && nmuonpass == 1 && PV_npvsGood > 0","0");
   }
   //Prescription to fill up WJets HT = 0-100
   if (_isHTstitching)
@@ -38,12 +61,7 @@ void SkimEvents::defineCuts()
 
 void SkimEvents::defineMoreVars()
 {
-        if(_year.find("16") != std::string::npos){
-            addVar({"Flag_filter","Flag_goodVertices && Flag_globalSuperTightHalo2016Filter && Flag_HBHENoiseFilter && Flag_HBHENoiseIsoFilter && Flag_EcalDeadCellTriggerPrimitiveFilter && Flag_BadPFMuonFilter && Flag_BadPFMuonDzFilter && Flag_eeBadScFilter && Flag_hfNoisyHitsFilter",""});
-        }else{
-            // For 17, 18 UL
-            addVar({"Flag_filter","Flag_goodVertices && Flag_globalSuperTightHalo2016Filter && Flag_HBHENoiseFilter && Flag_HBHENoiseIsoFilter && Flag_EcalDeadCellTriggerPrimitiveFilter && Flag_BadPFMuonFilter && Flag_BadPFMuonDzFilter && Flag_hfNoisyHitsFilter && Flag_eeBadScFilter && Flag_ecalBadCalibFilter",""});
-        }
+        addVar({"Flag_filter", flagSelection(), ""});
         // define variables that you want to store
         addVartoStore("run");
         addVartoStore("luminosityBlock");
@@ -18,7 +18,10 @@ class SkimEvents: public NanoAODAnalyzerrdframe
 		void defineCuts();
 		void defineMoreVars(); // define higher-level variables from
 		void bookHists();
+		std::string preselection() const;
         private:
+                std::string triggerSelection() const;
+                std::string flagSelection() const;
                 std::string _year;
                 std::string _syst;
 };
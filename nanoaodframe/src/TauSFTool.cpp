@@ -2,6 +2,8 @@
 #include <iostream> // std::cerr, std::endl
 #include <iomanip>
 #include <assert.h> // assert
+#include <algorithm>
+#include <cmath>
 
 TFile* ensureTFile(const TString filename, bool verbose=false){
   if(verbose)
@@ -215,6 +217,7 @@ TauIDSFTool::TauIDSFTool(const std::string& year, const std::string& id, const s
       TFile* file = ensureTFile(filename,verbose);
       hist = extractTH1(file,WP);
       hist->SetDirectory(nullptr);
+      histTable = ScaleFactorTable(hist, false);
       file->Close();
       delete file;
       DMs    = {0,1,10};
@@ -253,6 +256,7 @@ TauIDSFTool::TauIDSFTool(const std::string& year, const std::string& id, const s
       TFile* file = ensureTFile(filename,verbose);
       hist = extractTH1(file,WP);
       hist->SetDirectory(nullptr);
+      histTable = ScaleFactorTable(hist, false);
       file->Close();
       delete file;
       genmatches = {1,3};
@@ -266,6 +270,7 @@ TauIDSFTool::TauIDSFTool(const std::string& year, const std::string& id, const s
       TFile* file = ensureTFile(filename,verbose);
       hist = extractTH1(file,WP);
       hist->SetDirectory(nullptr);
+      histTable = ScaleFactorTable(hist, false);
       file->Close();
       delete file;
       genmatches = {2,4};
@@ -360,13 +365,12 @@ float TauIDSFTool::getSFvsDM(double pt, int dm, int genmatch, const std::string&
   if(!isVsDM) disabled();
   if(std::find(DMs.begin(),DMs.end(),dm)!=DMs.end() or pt<=40){
     if(genmatch==5){
-      Int_t bin = hist->GetXaxis()->FindBin(dm);
-      float SF  = static_cast<float>(hist->GetBinContent(bin));
+      sfvalues sf = histTable.get(dm);
       if(unc=="Up")
-        SF += hist->GetBinError(bin);
+        return sf.up;
       else if(unc=="Down")
-        SF -= hist->GetBinError(bin);
-      return SF;
+        return sf.down;
+      return sf.nom;
     }
     return 1.0;
   }
@@ -411,17 +415,113 @@ float TauIDSFTool::getSFvsDMandPT(double pt, int dm, const std::string& unc) con
 float TauIDSFTool::getSFvsEta(double eta, int genmatch, const std::string& unc) const{
   if(!isVsEta) disabled();
   if(std::find(genmatches.begin(),genmatches.end(),genmatch)!=genmatches.end()){
-    Int_t bin = hist->GetXaxis()->FindBin(eta);
-    float SF  = static_cast<float>(hist->GetBinContent(bin));
+    sfvalues sf = histTable.get(eta);
     if(unc=="Up")
-      SF += hist->GetBinError(bin);
+      return sf.up;
     else if(unc=="Down")
-      SF -= hist->GetBinError(bin);
-    return SF;
+      return sf.down;
+    return sf.nom;
   }
   return 1.0;
 }
 
+TauIDSFVsJetTable::TauIDSFVsJetTable(const TauIDSFTool& dmtool, const TauIDSFTool& highpttool, const std::string& year): DMs(dmtool.DMs){
+
+  if(!dmtool.isVsDMandPT or !highpttool.isHighPTVsPT){
+    std::cerr << std::endl << "ERROR! TauIDSFVsJetTable needs a pt-and-DM tool and a high pt tool!" << std::endl;
+    assert(0);
+  }
+
+  // low pt part: slots 0-16 per DM on the pt grid
+  lowpt.resize(DMs.size()*ngrid*nlowslots);
+  std::vector<std::string> uncerts = {"uncert0", "uncert1", "syst_alleras", "syst_"+year};
+  for(unsigned int d=0; d<DMs.size(); d++){
+    const std::map<std::string, const TF1*>* funcs = &dmtool.funcs_dm0;
+    if(DMs[d]==1) funcs = &dmtool.funcs_dm1;
+    if(DMs[d]==10) funcs = &dmtool.funcs_dm10;
+    if(DMs[d]==11) funcs = &dmtool.funcs_dm11;
+    auto eval = [funcs](const std::string& key, double pt) -> float {
+      auto it = funcs->find(key);
+      if(it==funcs->end() or it->second==nullptr){
+        std::cerr << "WARNING! TauIDSFVsJetTable: function for '" << key << "' not found, using nominal" << std::endl;
+        it = funcs->find("nom");
+      }
+      return it->second->Eval(pt);
+    };
+    std::string systdm = "syst_dm"+std::to_string(DMs[d])+"_"+year;
+    for(int p=0; p<ngrid; p++){
+      double pt = 20.0 + p;
+      float* row = &lowpt[(d*ngrid + p)*nlowslots];
+      float nomsf = eval("nom", pt);
+      row[0] = nomsf;
+      for(unsigned int u=0; u<uncerts.size(); u++){
+        row[1+2*u] = eval(uncerts[u]+"_up", pt);
+        row[2+2*u] = eval(uncerts[u]+"_down", pt);
+      }
+      for(int k=9; k<nlowslots; k++) row[k] = nomsf;
+      row[9+2*d] = eval(systdm+"_up", pt);
+      row[10+2*d] = eval(systdm+"_down", pt);
+    }
+  }
+
+  // high pt part: two measured pt bins, 100-200 and > 200
+  const TGraph* gnom = highpttool.graph.at("");
+  const TGraph* gsyst = highpttool.graph.at("syst_alleras");
+  const TGraph* goneera = highpttool.graph.at("syst_oneera");
+  extrap = highpttool.func.at("syst_extrap");
+  for(int bin=0; bin<2; bin++){
+    Double_t x=0., y=0.;
+    gnom->GetPoint(bin, x, y);
+    float SF = y;
+    float* row = highpt[bin];
+    double stat = sqrt(pow(gnom->GetErrorY(bin), 2) + pow(goneera->GetErrorY(bin), 2));
+    std::fill(row, row+nslots, SF);
+    row[17] = SF; row[17] += stat;
+    row[18] = SF; row[18] -= stat;
+    if(bin==0){ row[19] = SF; row[19] += stat; row[20] = SF; row[20] -= stat; }
+    if(bin==1){ row[21] = SF; row[21] += stat; row[22] = SF; row[22] -= stat; }
+    row[23] = SF; row[23] += gsyst->GetErrorY(bin);
+    row[24] = SF; row[24] -= gsyst->GetErrorY(bin);
+  }
+}
+
+void TauIDSFVsJetTable::fill(float pt, int dm, int genmatch, float* out) const{
+
+  if(genmatch!=5){
+    std::fill(out, out+nslots, 1.0f);
+    return;
+  }
+
+  int d = std::find(DMs.begin(),DMs.end(),dm) - DMs.begin();
+  if(d==int(DMs.size())) d = -1;
+
+  // TauSFTool clamps pt to [20, 140] for the DM dependent fits
+  float x = std::max(std::min(pt, 140.0f), 20.0f) - 20.0f;
+  int p = std::min(int(x), ngrid-1);
+  float t = x - p;
+  const float* row = d>=0 ? &lowpt[(d*ngrid + p)*nlowslots] : nullptr;
+  auto interp = [row, t](int k) -> float {
+    return t>0 ? row[k] + t*(row[nlowslots+k] - row[k]) : row[k];
+  };
+
+  float nomsf = d>=0 ? interp(0) : 1.0f;
+  out[0] = nomsf;
+  if(pt<=140){
+    if(d<0){
+      std::fill(out+1, out+nslots, 1.0f);
+      return;
+    }
+    for(int k=1; k<nlowslots; k++) out[k] = interp(k);
+    std::fill(out+nlowslots, out+nslots, nomsf);
+  } else {
+    const float* hrow = highpt[pt>=200 ? 1 : 0];
+    std::copy(hrow+1, hrow+25, out+1);
+    double f = extrap->Eval(pt);
+    out[25] = hrow[25]; out[25] *= f;
+    out[26] = hrow[26]; out[26] *= (2. - f);
+  }
+}
+
 TauESTool::TauESTool(const std::string& year, const std::string& id): ID(id){
 
     bool verbose = false;
@@ -27,6 +27,7 @@
 #include <map>       // std::map
 #include <stdlib.h>  // getenv
 #include <functional>
+#include "ScaleFactorTable.h"
 
 using namespace std;
 
@@ -37,11 +38,13 @@ class TauIDSFTool {
     std::map<const std::string,const TF1*> func;
     std::map<const std::string,const TGraph*> graph;
     TH1* hist;
+    ScaleFactorTable histTable; // flat copy of hist used by getSFvsDM/getSFvsEta
     std::map<std::string, const TF1*> funcs_dm0;
     std::map<std::string, const TF1*> funcs_dm1;
     std::map<std::string, const TF1*> funcs_dm10;
     std::map<std::string, const TF1*> funcs_dm11;
     [[noreturn]] void disabled() const;
+    friend class TauIDSFVsJetTable;
 
   public:
 
@@ -72,6 +75,44 @@ class TauIDSFTool {
 
 };
 
+/*
+ * @class TauIDSFVsJetTable
+ *
+ * All 27 vsJet SF slots written to tauWeightIdVsJet, precomputed at load time
+ * from a pt-and-DM dependent tool (ptdm=true) and a high pt tool (highpT=true).
+ *  - slot 0       : nominal (pt and DM dependent, pt clamped to [20, 140])
+ *  - pt <= 140    : 1-8 uncert0, uncert1, syst_alleras, syst_<year> up/down,
+ *                   9-16 syst_dm{0,1,10,11}_<year> up/down, 17-26 nominal
+ *  - pt > 140     : 1-16 high pt nominal, 17-26 stat, stat_bin1, stat_bin2, syst, extrap up/down
+ * The pt <= 140 part is tabulated on a 1 GeV grid and linearly interpolated,
+ * which reproduces TF1::Eval for the linear fits provided by Tau POG.
+ * Only the extrapolation uncertainty (pt > 140) needs a function evaluation.
+ *
+ */
+
+class TauIDSFVsJetTable {
+
+  public:
+
+    static const int nslots = 27;
+
+    TauIDSFVsJetTable(const TauIDSFTool& dmtool, const TauIDSFTool& highpttool, const std::string& year);
+    ~TauIDSFVsJetTable() { }
+
+    // writes the nslots values for one tau to out
+    void fill(float pt, int dm, int genmatch, float* out) const;
+
+  private:
+
+    static const int nlowslots = 17;
+    static const int ngrid = 121; // 20 to 140 GeV in steps of 1 GeV
+    std::vector<int> DMs;
+    std::vector<float> lowpt;     // [dm][grid point][nlowslots]
+    float highpt[2][nslots];      // [pt<200, pt>=200][slot], extrap slots hold the base SF
+    const TF1* extrap;
+
+};
+
 class TauESTool {
 
     protected:
@@ -103,6 +103,9 @@ void TopLFVAnalyzer::defineMoreVars() {
     addVar({"chi2_wqq_dPhi","top_reco_prod[1]",""});
     addVar({"chi2_wqq_dR","top_reco_prod[2]",""});
 
+    // Single top LFV classifier, replaces DNN/eval.py (output node 1 = signal)
+    if (dnnfile != "") _hasdnn = addDNN("dnn_score", dnnfile);
+
 
     // EventWeights
     // Calculate product of weights and store for systematic study
@@ -334,6 +337,7 @@ void TopLFVAnalyzer::defineMoreVars() {
     addVartoStore("btagWeight_DeepFlavB_jes");
     addVartoStore("eventWeight.*");
     addVartoStore("TopPtWeight");
+    if (_hasdnn) addVartoStore("dnn_score");
 }
 
 void TopLFVAnalyzer::bookHists() {
@@ -494,6 +498,8 @@ void TopLFVAnalyzer::bookHists() {
         add1DHist({"h_chi2_wqq_dEta", ";#Delta#eta of jets from W;Events", 25, -5, 5}, "chi2_wqq_dEta", "eventWeight", weightstr, "00000", maxstep);
         add1DHist({"h_chi2_wqq_dPhi", ";#Delta#phi of jets from W;Events;", 20, -4, 4}, "chi2_wqq_dPhi", "eventWeight", weightstr, "00000", maxstep);
         add1DHist({"h_chi2_wqq_dR", ";#Delta R of jets from W;Events", 20, 0, 4.0}, "chi2_wqq_dR", "eventWeight", weightstr, "00000", maxstep);
+
+        if (_hasdnn) add1DHist({"h_dnn_pred", ";DNN score;Events", 20, 0, 1.0}, "dnn_score", "eventWeight", weightstr, "00000", maxstep);
     }
 
 }
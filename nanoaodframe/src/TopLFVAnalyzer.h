@@ -18,12 +18,15 @@ public:
     void defineMoreVars(); // define higher-level variables from
     void bookHists();
     bool ext_syst = false;
+    // weights exported by DNN/export_weights.py, the score is not computed if empty
+    std::string dnnfile = "";
 
 private:
     std::string _year;
     std::string _syst;
     std::string maxstep;
     std::string tauYear = "";
+    bool _hasdnn = false;
 
 };
 
@@ -18,6 +18,8 @@ class WeightCalculatorFromHistogram {
   
   float getWeight(float x, float y=0) const;
   float getWeightErr(float x, float y=0) const;
+  // histogram used for the lookup (the ratio histogram for the two-histogram constructor)
+  const TH1* getHistogram() const { return histogram_; }
   
  private:
   std::vector<double> loadVals(TH1 *hist, bool norm=true);
@@ -3,26 +3,285 @@
 // Author      : Suyong Choi
 // Version     :
 // Copyright   : suyong@korea.ac.kr, Korea University, Department of Physics
-// Description : Hello World in C, Ansi-style
+// Description : Job driver for skimming (SkimEvents) and processing
+//               (TopLFVAnalyzer), same options as skimonefile.py,
+//               processonefile.py and processonedataset.py
+//
+// nanoaodrdataframe [--skim] -I in.root [-I in2.root ...] -O out.root -Y year [-S syst]
+//                   [-J json] [--globaltag tag] [--saveallbranches] [--dnn weights.txt] [-j nthreads]
+//                   [--cache dir] [--checkpoint] [--fullread] [--compress-threads N] [--export cols]
+//                   [--dense-hists] [--quantize-sf]
+// nanoaodrdataframe -D indir -O out.root -Y year [-S syst] ...   (all .root files in indir)
+//
+// With -j N > 1 the inputs are split into entry ranges processed by N
+// workers and merged into the output (DatasetProcessor). With --cache the
+// output of every range is kept in dir, keyed on the input, the analyzer
+// configuration and the binary (ProcessingCache), and reused by later runs.
+// With --checkpoint the finished ranges are listed in out.root.manifest and
+// a rerun of the same command continues from there.
+// With --compress-threads N the ranges are written uncompressed and
+// compressed by N separate threads while the workers go on, so the event
+// loops do not wait for the compression of the output baskets.
+// With --export the listed columns (comma separated regular expressions)
+// are also written as float32 .npy files in out_columns/ for the DNN scripts.
+// With --dense-hists the histograms are written as one TH3D per variable
+// (variation x cut step x bin, ShapeStore); expandshapes converts them back.
+// With --quantize-sf skims store the scale factor columns as 16 bit fixed
+// point codes (SFCodec), which the processing decodes by itself.
+//
+// Skims first select the entries passing the trigger, flag and muon part of
+// the selection, reading only those branches, and then read the other
+// branches for the selected entries only (--fullread reads everything).
+//
+// Without -J, data (syst "data" or SingleMuon input) is processed with the
+// golden JSON of the year. Without --globaltag, skims use the global tag of
+// the input file name. Both come from the tables in JobDefaults.cpp.
 //============================================================================
 
-#include <stdio.h>
-#include <stdlib.h>
+#include <getopt.h>
+#include <dirent.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
 #include <string>
+#include <vector>
+
+#include "TChain.h"
+#include "TFile.h"
+#include "TH1.h"
+#include "TROOT.h"
+
 #include "NanoAODAnalyzerrdframe.h"
 #include "TopLFVAnalyzer.h"
-#include "TChain.h"
+#include "SkimEvents.h"
+#include "JobDefaults.h"
+#include "DatasetProcessor.h"
 
 using namespace std;
 using namespace ROOT;
 
-int main(void) {
-  TChain c1("outputTree");
-  c1.Add("processed/2016data/2016b/00/nanoAOD_3_analyzed.root");
+namespace {
+
+void usage()
+{
+    cout << "usage: nanoaodrdataframe [options]" << endl
+         << "  -I, --infile FILE       input file, can be repeated" << endl
+         << "  -D, --indir DIR         process all .root files with events in DIR" << endl
+         << "  -O, --outfile FILE      output file" << endl
+         << "  -Y, --year YEAR         2016pre, 2016post, 2017 or 2018" << endl
+         << "  -S, --syst SYST         systematic sources ('data' for data)" << endl
+         << "  -J, --json FILE         golden JSON, default from the year for data" << endl
+         << "      --globaltag TAG     JetMET global tag, default from the input file name for skims" << endl
+         << "      --saveallbranches   save all branches" << endl
+         << "      --skim              skim NanoAOD (SkimEvents) instead of processing skims" << endl
+         << "      --dnn FILE          DNN weights, stores dnn_score (processing only)" << endl
+         << "  -j, --nthreads N        number of threads (default 1)" << endl
+         << "      --cache DIR         reuse and store the outputs of unchanged inputs in DIR" << endl
+         << "      --checkpoint        keep finished entry ranges, a rerun resumes the job" << endl
+         << "      --fullread          skims: no preselection pass, read all entries of all branches" << endl
+         << "      --compress-threads N  compress the output in N threads separate from the event loops" << endl
+         << "      --export COLS       also write these columns (comma separated regexps) as .npy files in <output>_columns" << endl
+         << "      --dense-hists       histograms as one TH3D per variable in shapes/ (see expandshapes)" << endl
+         << "      --quantize-sf       skims: store the scale factor columns as 16 bit fixed point (see src/SFCodec.h)" << endl;
+}
+
+// .root files in indir, empty ones are skipped when the chain or DatasetProcessor reads them
+std::vector<std::string> rootFilesIn(const std::string &indir)
+{
+    std::vector<std::string> files;
+    DIR *dir = opendir(indir.c_str());
+    if (dir == nullptr) {
+        cout << "ERROR! Cannot read directory " << indir << endl;
+        return files;
+    }
+    while (struct dirent *entry = readdir(dir)) {
+        std::string fname = entry->d_name;
+        if (fname.size() < 5 || fname.compare(fname.size()-5, 5, ".root") != 0) continue;
+        files.push_back(indir + "/" + fname);
+    }
+    closedir(dir);
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+// adds up the counter histograms of the inputs into the output, as processonefile.py
+void copyCounterHistogram(const std::vector<std::string> &infiles, const std::string &outfile)
+{
+    std::unique_ptr<TH1> counter;
+    for (auto &fname : infiles) {
+        std::unique_ptr<TFile> f(TFile::Open(fname.c_str()));
+        if (!f || f->IsZombie()) continue;
+        TH1 *h = f->Get<TH1>("hcounter");
+        if (h == nullptr) continue;
+        if (counter) counter->Add(h);
+        else {
+            counter.reset(static_cast<TH1 *>(h->Clone()));
+            counter->SetDirectory(0);
+        }
+    }
+    if (!counter) {
+        cout << "counter histogram not found" << endl;
+        return;
+    }
+    cout << "Updating with counter histogram" << endl;
+    TFile outf(outfile.c_str(), "UPDATE");
+    counter->Write("", TObject::kOverwrite);
+    outf.Close();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+
+    std::vector<std::string> infiles;
+    std::string indir = "";
+    std::string outfile = "";
+    std::string year = "";
+    std::string syst = "";
+    std::string json = "";
+    std::string globaltag = "";
+    std::string dnnfile = "";
+    std::string cachedir = "";
+    bool saveallbranches = false;
+    bool skim = false;
+    bool checkpoint = false;
+    bool fullread = false;
+    int nthreads = 1;
+    int compressthreads = 0;
+    std::vector<std::string> exportcolumns;
+    bool densehists = false;
+    bool quantizesf = false;
+
+    enum { kGlobalTag = 1000, kSaveAll, kSkim, kDNN, kCache, kCheckpoint, kFullRead, kCompressThreads, kExport, kDenseHists, kQuantizeSF };
+    const struct option longopts[] = {
+        {"infile", required_argument, nullptr, 'I'},
+        {"indir", required_argument, nullptr, 'D'},
+        {"outfile", required_argument, nullptr, 'O'},
+        {"year", required_argument, nullptr, 'Y'},
+        {"syst", required_argument, nullptr, 'S'},
+        {"json", required_argument, nullptr, 'J'},
+        {"nthreads", required_argument, nullptr, 'j'},
+        {"globaltag", required_argument, nullptr, kGlobalTag},
+        {"saveallbranches", no_argument, nullptr, kSaveAll},
+        {"skim", no_argument, nullptr, kSkim},
+        {"dnn", required_argument, nullptr, kDNN},
+        {"cache", required_argument, nullptr, kCache},
+        {"checkpoint", no_argument, nullptr, kCheckpoint},
+        {"fullread", no_argument, nullptr, kFullRead},
+        {"compress-threads", required_argument, nullptr, kCompressThreads},
+        {"export", required_argument, nullptr, kExport},
+        {"dense-hists", no_argument, nullptr, kDenseHists},
+        {"quantize-sf", no_argument, nullptr, kQuantizeSF},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "I:D:O:Y:S:J:j:h", longopts, nullptr)) != -1) {
+        switch (opt) {
+        case 'I': infiles.push_back(optarg); break;
+        case 'D': indir = optarg; break;
+        case 'O': outfile = optarg; break;
+        case 'Y': year = optarg; break;
+        case 'S': syst = optarg; break;
+        case 'J': json = optarg; break;
+        case 'j': nthreads = std::max(1, atoi(optarg)); break;
+        case kGlobalTag: globaltag = optarg; break;
+        case kSaveAll: saveallbranches = true; break;
+        case kSkim: skim = true; break;
+        case kDNN: dnnfile = optarg; break;
+        case kCache: cachedir = optarg; break;
+        case kCheckpoint: checkpoint = true; break;
+        case kFullRead: fullread = true; break;
+        case kCompressThreads: compressthreads = std::max(0, atoi(optarg)); break;
+        case kDenseHists: densehists = true; break;
+        case kQuantizeSF: quantizesf = true; break;
+        case kExport: {
+            std::istringstream columns(optarg);
+            for (std::string column; std::getline(columns, column, ',');) {
+                if (column != "") exportcolumns.push_back(column);
+            }
+            break;
+        }
+        default: usage(); return EXIT_FAILURE;
+        }
+    }
+    for (int i=optind; i<argc; i++) infiles.push_back(argv[i]);
+    if (indir != "") {
+        auto found = rootFilesIn(indir);
+        if (found.empty()) {
+            cout << "No file found in " << indir << ", ending processing" << endl;
+            return EXIT_SUCCESS;
+        }
+        infiles.insert(infiles.end(), found.begin(), found.end());
+    }
+    if (infiles.empty() || outfile == "" || year == "") {
+        usage();
+        return EXIT_FAILURE;
+    }
+    if (quantizesf && (!skim || saveallbranches)) {
+        cout << "WARNING! --quantize-sf applies to skims storing selected branches only, ignored" << endl;
+        quantizesf = false;
+    }
+    if (outfile.size() < 5 || outfile.compare(outfile.size()-5, 5, ".root") != 0) {
+        cout << "Output file should be a root file! Quitting" << endl;
+        return EXIT_FAILURE;
+    }
+
+    // defaults from JobDefaults tables
+    bool isdata = syst == "data" || infiles[0].find("SingleMuon") != std::string::npos;
+    if (json == "" && !skim && isdata) json = defaultGoldenJSON(year);
+    if (globaltag == "" && skim) globaltag = defaultGlobalTag(infiles[0], year);
+    cout << "Input: " << infiles.size() << " file(s), Output: " << outfile << ", Syst: " << syst
+         << ", Json: " << json << ", Global tag: " << globaltag << ", Threads: " << nthreads << endl;
+
+    auto makeAnalyzer = [&](TTree *t, std::string outname) -> std::unique_ptr<NanoAODAnalyzerrdframe> {
+        if (skim) {
+            auto analyzer = new SkimEvents(t, outname, year, syst, json, globaltag, 1);
+            analyzer->setLazyRead(!fullread);
+            analyzer->setQuantizedFactors(quantizesf);
+            return std::unique_ptr<NanoAODAnalyzerrdframe>(analyzer);
+        }
+        auto analyzer = new TopLFVAnalyzer(t, outname, year, syst, json, globaltag, 1);
+        analyzer->dnnfile = dnnfile;
+        if (!exportcolumns.empty()) analyzer->setColumnExport(exportcolumns);
+        analyzer->setDenseHistograms(densehists);
+        return std::unique_ptr<NanoAODAnalyzerrdframe>(analyzer);
+    };
+
+    if (nthreads > 1 || cachedir != "" || checkpoint || compressthreads > 0) {
+        // files split into entry ranges, one single threaded analyzer per range
+        DatasetProcessor dataset(infiles);
+        if (cachedir != "") dataset.setCache(cachedir);
+        if (checkpoint) dataset.setCheckpoint();
+        // the options that change the output, a checkpointed job is only resumed with the same
+        std::ostringstream configuration;
+        configuration << "skim " << skim << "\nyear " << year << "\nsyst " << syst
+                      << "\njson " << json << " " << ProcessingCache::fileHash(json) << "\nglobaltag " << globaltag
+                      << "\ndnn " << dnnfile << " " << ProcessingCache::fileHash(dnnfile)
+                      << "\ndense " << densehists << "\nquantize " << quantizesf << "\nexport";
+        for (auto &column : exportcolumns) configuration << " " << column;
+        dataset.setJobConfiguration(configuration.str());
+        if (compressthreads > 0) dataset.setAsyncCompression(compressthreads);
+        if (dataset.entries() == 0) {
+            cout << "There is NO EVENT to process, ending the processing!!" << endl;
+            return EXIT_SUCCESS;
+        }
+        return dataset.run(makeAnalyzer, outfile, nthreads, saveallbranches, "Events") ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
 
-  TopLFVAnalyzer nanoaodrdf(&c1, "testout.root", "2016pre", "", "data/Cert_271036-284044_13TeV_23Sep2016ReReco_Collisions16_JSON.txt", "", 1);
-  nanoaodrdf.setupAnalysis();
-  nanoaodrdf.run(false, "Events");
+    TChain c1("Events");
+    for (auto &f : infiles) c1.Add(f.c_str());
+    if (c1.GetEntries() == 0) {
+        cout << "There is NO EVENT to process, ending the processing!!" << endl;
+        return EXIT_SUCCESS;
+    }
+    auto nanoaodrdf = makeAnalyzer(&c1, outfile);
+    nanoaodrdf->setupAnalysis();
+    nanoaodrdf->run(saveallbranches, "Events");
+    if (!skim) copyCounterHistogram(infiles, outfile);
 
-  return EXIT_SUCCESS;
+    return EXIT_SUCCESS;
 }
@@ -5,13 +5,15 @@
  *      Author: suyong
  */
 #include "utility.h"
-#include "TMatrixDSym.h"
-#include "TVectorT.h"
-#include "Math/SpecFuncMathMore.h"
+#include "ObjectCollection.h"
+#include "GenRecord.h"
+#include "EventShapes.h"
 #include "Math/GenVector/VectorUtil.h"
 #include "Math/GenVector/Rotation3D.h"
 #include "Math/Math.h"
 
+#include <algorithm>
+
 // Utility function to generate fourvector objects for thigs that pass selections
 
 FourVectorVec gen4vec(floats &pt, floats &eta, floats &phi, floats &mass)
@@ -49,59 +51,94 @@ floats weightv(floats &x, float evWeight)
 
 floats sphericity(FourVectorVec &p)
 {
-	TMatrixDSym NormMomTensor(3);
-
-	NormMomTensor = 0.0;
+	double NormMomTensor[6] = {0., 0., 0., 0., 0., 0.};
 	double p2sum = 0.0;
-	for (auto x: p)
+	for (auto &x: p)
 	{
-		p2sum += x.P2();
-		double mom[3] = {x.Px(), x.Py(), x.Pz()};
-		for (int irow=0; irow<3; irow++)
-		{
-			for (int icol=irow; icol<3; icol++)
-			{
-				NormMomTensor(irow, icol) += mom[irow] * mom[icol];
-			}
-		}
+		double px = x.Px(), py = x.Py(), pz = x.Pz();
+		p2sum += px*px + py*py + pz*pz;
+		NormMomTensor[0] += px*px;
+		NormMomTensor[1] += py*py;
+		NormMomTensor[2] += pz*pz;
+		NormMomTensor[3] += px*py;
+		NormMomTensor[4] += px*pz;
+		NormMomTensor[5] += py*pz;
 	}
-	NormMomTensor *= (1.0/p2sum);
-	TVectorT<double> Qrev;
-	NormMomTensor.EigenVectors(Qrev);
-	floats Q(3);
+	floats Q(3, 0.0);
+	if (p2sum <= 0.0) return Q;
+	for (auto &t: NormMomTensor) t /= p2sum;
+	double Qrev[3];
+	symEigenvalues3(NormMomTensor, Qrev);
 	for (auto i=0; i<3; i++) Q[i] = Qrev[2-i];
 
 	return Q;
 }
 
 
-double foxwolframmoment(int l, FourVectorVec &p, int minj, int maxj)
+doubles foxwolframmoments(int lmax, FourVectorVec &p, int minj, int maxj)
 {   // PRD 87, 073014 (2013)
-	double answer = 0.0;
-
-	double ptsum=0.0;
+	// H_l = sum_ij pt_i pt_j P_l(cos dOmega_ij) / (sum_i pt_i)^2 for l = 0..lmax,
+	// all orders from one pass over the pairs with the Legendre recurrence
+	// (l+1) P_l+1(x) = (2l+1) x P_l(x) - l P_l-1(x)
+	if (lmax < 0) return doubles();
+	doubles answer(lmax+1, 0.0);
 
 	if (maxj==-1) // process everything
 	{
 		maxj = p.size();
 	}
-	//for (auto x: p)
-	for (auto i=minj; i<maxj; i++)
+	const int n = maxj - minj;
+	if (n <= 0) return answer;
+
+	// unit vectors and weights, cached once
+	doubles ux(n), uy(n), uz(n), pt(n);
+	double ptsum = 0.0;
+	for (auto i=0; i<n; i++)
+	{
+		auto &x = p[minj+i];
+		double mag = x.P();
+		ux[i] = x.Px() / mag;
+		uy[i] = x.Py() / mag;
+		uz[i] = x.Pz() / mag;
+		pt[i] = x.Pt();
+		ptsum += pt[i];
+	}
+
+	// i == j: cos dOmega = 1 and P_l(1) = 1 for every order
+	double diag = 0.0;
+	for (auto i=0; i<n; i++) diag += pt[i] * pt[i];
+
+	// i != j: each pair counted twice
+	doubles offdiag(lmax+1, 0.0);
+	for (auto i=0; i<n; i++)
 	{
-		auto x = p[i];
-		ptsum += x.Pt();
-		//for (auto y: p)
-		for (auto j=minj; j<maxj; j++)
+		for (auto j=i+1; j<n; j++)
 		{
-			auto y = p[j];
-			double wij = x.Pt() * y.Pt();
-			double cosdOmega = x.Vect().Dot(y.Vect()) / (x.P() * y.P());
+			double wij = pt[i] * pt[j];
+			double cosdOmega = ux[i]*ux[j] + uy[i]*uy[j] + uz[i]*uz[j];
 			if (cosdOmega>1.0) cosdOmega=1.0;
 			if (cosdOmega<-1.0) cosdOmega=-1.0;
-			answer += wij * ROOT::Math::legendre(l, cosdOmega);
+			double pprev = 1.0, pcur = cosdOmega;
+			offdiag[0] += wij;
+			if (lmax >= 1) offdiag[1] += wij * pcur;
+			for (auto l=1; l<lmax; l++)
+			{
+				double pnext = ((2*l+1) * cosdOmega * pcur - l * pprev) / (l+1);
+				pprev = pcur;
+				pcur = pnext;
+				offdiag[l+1] += wij * pcur;
+			}
 		}
 	}
-	answer /= ptsum*ptsum;
+
+	for (auto l=0; l<=lmax; l++) answer[l] = (diag + 2.0*offdiag[l]) / (ptsum*ptsum);
+	return answer;
+}
+
+double foxwolframmoment(int l, FourVectorVec &p, int minj, int maxj)
+{
+	if (l < 0) return 0.0;
+	double answer = foxwolframmoments(l, p, minj, maxj)[l];
 	if (fabs(answer)>1.0) std::cout << "FW>1 " << answer << std::endl;
 	return answer;
 }
@@ -119,11 +156,73 @@ ints good_idx(ints good)
 }
 
 
+// W -> qq candidate for the chi2 top reconstruction: jets a < b, neither is the b-jet
+struct wcandidate
+{
+        int j1;
+        int j2;
+        float SMW_mass;
+        float SMtop_mass;
+        float X_SMW;
+        float X_SMtop;
+        float X;
+};
+
+static float mass_from_components(double e, double px, double py, double pz){
+        double m2 = e*e - px*px - py*py - pz*pz;
+        return m2 > 0 ? std::sqrt(m2) : -std::sqrt(-m2);
+}
+
+// index of the jet that is the leading b-jet, -1 if none
+static int find_bjet_idx(FourVectorVec &jets, FourVectorVec &bjets){
+        if (bjets.empty()) return -1;
+        for (int j = 0; j<int(jets.size()); j++){
+                if (jets[j].Pt() == bjets[0].Pt()) return j;
+        }
+        return -1;
+}
+
+// all W candidates with their SM top chi2 terms, sorted by increasing chi2
+static std::vector<wcandidate> w_candidates(const ObjectCollection &jets, const FourVector &bjet, int bidx, float MW, float WW, float MT, float WT){
+        std::vector<wcandidate> cands;
+        const int njets = jets.size();
+        if (njets < 2) return cands;
+        cands.reserve(njets*(njets-1)/2);
+
+        const floats &px = jets.px();
+        const floats &py = jets.py();
+        const floats &pz = jets.pz();
+        const floats &e = jets.e();
+        const double bpx = bjet.Px(), bpy = bjet.Py(), bpz = bjet.Pz(), be = bjet.E();
+
+        for (int a = 0; a<njets; a++){
+                if (a == bidx) continue;
+                for (int b = a+1; b<njets; b++){
+                        if (b == bidx) continue;
+                        double wpx = double(px[a]) + px[b];
+                        double wpy = double(py[a]) + py[b];
+                        double wpz = double(pz[a]) + pz[b];
+                        double we = double(e[a]) + e[b];
+                        wcandidate c;
+                        c.j1 = a;
+                        c.j2 = b;
+                        c.SMW_mass = mass_from_components(we, wpx, wpy, wpz);
+                        c.SMtop_mass = mass_from_components(we + be, wpx + bpx, wpy + bpy, wpz + bpz);
+                        float dW = (MW - c.SMW_mass)/WW;
+                        float dT = (MT - c.SMtop_mass)/WT;
+                        c.X_SMW = dW*dW;
+                        c.X_SMtop = dT*dT;
+                        c.X = c.X_SMW + c.X_SMtop;
+                        cands.push_back(c);
+                }
+        }
+        std::stable_sort(cands.begin(), cands.end(), [](const wcandidate &x, const wcandidate &y){ return x.X < y.X; });
+        return cands;
+}
+
 floats top_reconstruction_STLFV(FourVectorVec &jets, FourVectorVec &bjets, FourVectorVec &muons, FourVectorVec &taus){
         
         floats out;
-        float SMW_mass, SMtop_mass;
-        float X_SMW, X_SMtop;
         float X_min=9999999999, X_min_SMW_mass=-1, X_min_SMtop_mass=-1;
         float X_min_SMW=999999999, X_min_SMtop=999999999;
         float wj1_idx=-1, wj2_idx=-1;
@@ -131,27 +230,21 @@ floats top_reconstruction_STLFV(FourVectorVec &jets, FourVectorVec &bjets, FourV
         const float MW = 80.8;
         const float WT = 21.3;
         const float WW = 11.71;	
-        
-        // Jets from W-1
-        for(int j1 = 0; j1<int(jets.size()); j1++){
-            if(jets[j1].Pt() == bjets[0].Pt()) continue;
-            // Jets from W-2
-            for(int j2 = 0; j2<int(jets.size()); j2++){
-                if(jets[j2].Pt() == jets[j1].Pt() || jets[j2].Pt() == bjets[0].Pt()) continue;
-                SMW_mass = (jets[j1]+jets[j2]).M();
-                X_SMW = std::pow((MW-SMW_mass)/WW,2);
-                SMtop_mass = (bjets[0]+jets[j1]+jets[j2]).M();
-                X_SMtop = std::pow((MT-SMtop_mass)/WT,2);
-                if (X_SMW + X_SMtop < X_min){
-                    X_min = X_SMW + X_SMtop;
-                    X_min_SMW = X_SMW;
-                    X_min_SMtop = X_SMtop;
-                    X_min_SMW_mass = SMW_mass;
-                    X_min_SMtop_mass = SMtop_mass;
-                    wj1_idx = float(j1);
-                    wj2_idx = float(j2);
+
+        if (!bjets.empty()){
+                ObjectCollection jetcoll(jets);
+                std::vector<wcandidate> cands = w_candidates(jetcoll, bjets[0], find_bjet_idx(jets, bjets), MW, WW, MT, WT);
+                // candidates are sorted, the first one is the minimum
+                if (!cands.empty() && cands[0].X < X_min){
+                        const wcandidate &best = cands[0];
+                        X_min = best.X;
+                        X_min_SMW = best.X_SMW;
+                        X_min_SMtop = best.X_SMtop;
+                        X_min_SMW_mass = best.SMW_mass;
+                        X_min_SMtop_mass = best.SMtop_mass;
+                        wj1_idx = float(best.j1);
+                        wj2_idx = float(best.j2);
                 }
-            }
         }
         out.push_back(X_min);               // 0
         out.push_back(X_min_SMW_mass);      // 1
@@ -164,11 +257,12 @@ floats top_reconstruction_STLFV(FourVectorVec &jets, FourVectorVec &bjets, FourV
         return out;
 }
 
+// chi2 = X_LFVtop(j1) + X_SMW(j2,j3) + X_SMtop(b,j2,j3), the LFV and SM terms
+// only share the constraint j1 != j2,j3. Both lists are sorted by chi2 and a
+// branch is dropped as soon as its lower bound reaches the current minimum.
 floats top_reconstruction_TTLFV(FourVectorVec &jets, FourVectorVec &bjets, FourVectorVec &muons, FourVectorVec &taus){
         
         floats out;
-        float LFVtop_mass, SMW_mass, SMtop_mass;
-        float X_LFVtop, X_SMW, X_SMtop;
         float X_min=9999999999, X_min_LFVtop_mass=-1, X_min_SMW_mass=-1, X_min_SMtop_mass=-1;
         float X_min_LFVtop=999999999, X_min_SMW=999999999, X_min_SMtop=999999999;
         float lfvj_idx=-1, wj1_idx=-1, wj2_idx=-1;
@@ -180,35 +274,44 @@ floats top_reconstruction_TTLFV(FourVectorVec &jets, FourVectorVec &bjets, FourV
         const float WT_LFV = 17.8;
         const float WT_SM = 21.3;
         const float WW = 11.71;	
-        
-        // lfv jet
-        for(int j1 = 0; j1<int(jets.size()); j1++){
-            LFVtop_mass = (jets[j1]+taus[0]+muons[0]).M();
-            X_LFVtop = std::pow((MT_LFV-LFVtop_mass)/WT_LFV,2);
-            // Jet1 from W
-            for(int j2 = 0; j2<int(jets.size()); j2++){
-                if(jets[j2].Pt() == bjets[0].Pt() || jets[j2].Pt() == jets[j1].Pt()) continue;
-                // Jet2 from W
-                for(int j3 = 0; j3<int(jets.size()); j3++){
-                    if(jets[j3].Pt() == jets[j2].Pt() || jets[j3].Pt() == bjets[0].Pt() || jets[j3].Pt() == jets[j1].Pt()) continue;
-                    SMW_mass = (jets[j2]+jets[j3]).M();
-                    X_SMW = std::pow((MW-SMW_mass)/WW,2);
-                    SMtop_mass = (bjets[0]+jets[j2]+jets[j3]).M();
-                    X_SMtop = std::pow((MT_SM-SMtop_mass)/WT_SM,2);
-                    if (X_LFVtop + X_SMW + X_SMtop < X_min){
-                        X_min = X_LFVtop + X_SMW + X_SMtop;
-                        X_min_LFVtop = X_LFVtop;
-                        X_min_SMW = X_SMW;
-                        X_min_SMtop = X_SMtop;
-                        X_min_LFVtop_mass = LFVtop_mass;
-                        X_min_SMW_mass = SMW_mass;
-                        X_min_SMtop_mass = SMtop_mass;
-                        lfvj_idx = float(j1);
-                        wj1_idx = float(j2);
-                        wj2_idx = float(j3);
-                    }
+
+        if (!bjets.empty() && !muons.empty() && !taus.empty()){
+                ObjectCollection jetcoll(jets);
+                const int njets = jetcoll.size();
+                std::vector<wcandidate> cands = w_candidates(jetcoll, bjets[0], find_bjet_idx(jets, bjets), MW, WW, MT_SM, WT_SM);
+
+                // lfv jet
+                FourVector mutau = taus[0] + muons[0];
+                const double mtpx = mutau.Px(), mtpy = mutau.Py(), mtpz = mutau.Pz(), mte = mutau.E();
+                std::vector<std::pair<float, int>> lfvjets;
+                floats LFVtop_mass(njets);
+                lfvjets.reserve(njets);
+                for (int j1 = 0; j1<njets; j1++){
+                        LFVtop_mass[j1] = mass_from_components(jetcoll.e()[j1] + mte, jetcoll.px()[j1] + mtpx, jetcoll.py()[j1] + mtpy, jetcoll.pz()[j1] + mtpz);
+                        float d = (MT_LFV - LFVtop_mass[j1])/WT_LFV;
+                        lfvjets.emplace_back(d*d, j1);
+                }
+                std::stable_sort(lfvjets.begin(), lfvjets.end(), [](const std::pair<float, int> &x, const std::pair<float, int> &y){ return x.first < y.first; });
+
+                for (auto &lfvjet : lfvjets){
+                        if (cands.empty() || lfvjet.first + cands[0].X >= X_min) break;
+                        for (auto &w : cands){
+                                if (lfvjet.first + w.X >= X_min) break;
+                                if (w.j1 == lfvjet.second || w.j2 == lfvjet.second) continue;
+                                // first W candidate not sharing the lfv jet is the best one for it
+                                X_min = lfvjet.first + w.X_SMW + w.X_SMtop;
+                                X_min_LFVtop = lfvjet.first;
+                                X_min_SMW = w.X_SMW;
+                                X_min_SMtop = w.X_SMtop;
+                                X_min_LFVtop_mass = LFVtop_mass[lfvjet.second];
+                                X_min_SMW_mass = w.SMW_mass;
+                                X_min_SMtop_mass = w.SMtop_mass;
+                                lfvj_idx = float(lfvjet.second);
+                                wj1_idx = float(w.j1);
+                                wj2_idx = float(w.j2);
+                                break;
+                        }
                 }
-            }
         }
         out.push_back(X_min);               // 0
         out.push_back(X_min_LFVtop_mass);   // 1
@@ -355,18 +458,14 @@ ints find_element_binary( ints vec, int a){
 
 /////Find last genparticle using pdgid/////(i : idx, id : pdgId, t : target, d: daughter)
 ints LastGenPart_idx( int target_id, ints GenPart_pdgId, ints GenPart_genPartIdxMother){
+    return LastGenPart_idx(target_id, GenRecord(GenPart_pdgId, GenPart_genPartIdxMother));
+}
+
+ints LastGenPart_idx( int target_id, const GenRecord &rec){
     ints out;
-    for( int idx = 0 ; idx < int(GenPart_pdgId.size()); idx++){
-        int p_id = GenPart_pdgId[idx];
-        if(abs(p_id)==target_id){
-            bool isLastParticle = true;
-            ints daughters_idx = find_element(GenPart_genPartIdxMother, idx);
-            for(int d_idx:daughters_idx){
-                int d_id = GenPart_pdgId[d_idx];
-                if (abs(d_id)==target_id) isLastParticle = false;
-            }
-            if(isLastParticle) out.emplace_back(idx);
-        }
+    auto candidates = rec.withAbsPdgId(abs(target_id));
+    for( const int *idx = candidates.first; idx != candidates.second; idx++){
+        if( rec.hasNoDaughterWithAbsPdgId(*idx, abs(target_id)) ) out.emplace_back(*idx);
     }
     return out;
 }
@@ -374,62 +473,48 @@ ints LastGenPart_idx( int target_id, ints GenPart_pdgId, ints GenPart_genPartIdx
 
 /////Find last genparticle using idx/////
 int lastgenpart_idx(int target_i, ints GenPart_pdgId, ints GenPart_genPartIdxMother){
-    int out;
-    int target_id = GenPart_pdgId[target_i];
-
-    int ttemp_i = target_i;
-    while(true){
-        bool LP = true;
-        ints daughters_i = find_element(GenPart_genPartIdxMother, ttemp_i);
-        if ( daughters_i.size() == 0 ){}
-
-        else for( int dtemp_i: daughters_i){
-            int dtemp_id = GenPart_pdgId[dtemp_i];
-            if( dtemp_id == target_id ){
-                LP = false;
-                ttemp_i = dtemp_i;
-            }
-        }
-        if( LP ){
-        out=ttemp_i;
-        break;
-        }
-    }
-    return out;
+    return GenRecord(GenPart_pdgId, GenPart_genPartIdxMother).lastCopy(target_i);
+}
+
+int lastgenpart_idx(int target_i, const GenRecord &rec){
+    return rec.lastCopy(target_i);
 }
 
 ints FinalGenPart_idx( ints GenPart_pdgId, ints GenPart_genPartIdxMother ){
+    return FinalGenPart_idx(GenRecord(GenPart_pdgId, GenPart_genPartIdxMother));
+}
+
+ints FinalGenPart_idx( const GenRecord &rec ){
     ints out;
     int LFVtop_idx = -1, SMtop_idx=-1;
     int up_idx = -1, muon_idx = -1, tau_idx = -1;
     int b_idx = -1, W_idx = -1;
     int Wq1_idx=-1, Wq2_idx=-1;
-    ints Wds_i;
-    ints LastTop_idx = LastGenPart_idx(6, GenPart_pdgId, GenPart_genPartIdxMother);
+    const std::vector<int> &daughters = rec.daughters();
+    ints LastTop_idx = LastGenPart_idx(6, rec);
     for( int i : LastTop_idx ){
-        ints ds_idx = find_element(GenPart_genPartIdxMother, i);
-        for( int d_idx : ds_idx ){
-            int d_id = GenPart_pdgId[d_idx];
+        for( int k = rec.daughterBegin(i); k < rec.daughterEnd(i); k++ ){
+            int d_idx = daughters[k];
+            int d_id = rec.pdgId(d_idx);
             if( abs(d_id) == 4 || abs(d_id) == 2){
-                up_idx = lastgenpart_idx(d_idx, GenPart_pdgId, GenPart_genPartIdxMother);
+                up_idx = rec.lastCopy(d_idx);
                 LFVtop_idx=i;
             }
             if(abs(d_id)==13){
-                muon_idx = lastgenpart_idx(d_idx, GenPart_pdgId, GenPart_genPartIdxMother);
+                muon_idx = rec.lastCopy(d_idx);
             }
             if(abs(d_id)==15){
-                tau_idx = lastgenpart_idx(d_idx, GenPart_pdgId, GenPart_genPartIdxMother);
+                tau_idx = rec.lastCopy(d_idx);
             }
             if(abs(d_id)==5){
-                b_idx = lastgenpart_idx(d_idx, GenPart_pdgId, GenPart_genPartIdxMother);
+                b_idx = rec.lastCopy(d_idx);
                 SMtop_idx=i;
             }
             if(abs(d_id)==24){
-                W_idx = lastgenpart_idx(d_idx, GenPart_pdgId, GenPart_genPartIdxMother);
-                Wds_i = find_element(GenPart_genPartIdxMother, W_idx);
-                if( Wds_i.size() !=2 ) break;
-                Wq1_idx = lastgenpart_idx(Wds_i[0], GenPart_pdgId, GenPart_genPartIdxMother);
-                Wq2_idx = lastgenpart_idx(Wds_i[1], GenPart_pdgId, GenPart_genPartIdxMother);
+                W_idx = rec.lastCopy(d_idx);
+                if( rec.ndaughters(W_idx) !=2 ) break;
+                Wq1_idx = rec.lastCopy(daughters[rec.daughterBegin(W_idx)]);
+                Wq2_idx = rec.lastCopy(daughters[rec.daughterBegin(W_idx)+1]);
             }
         }
     }
@@ -447,29 +532,58 @@ ints FinalGenPart_idx( ints GenPart_pdgId, ints GenPart_genPartIdxMother ){
 
 
 ints dRmatching_binary( int origin_i,float maxdR,  floats origin_pt, floats origin_eta, floats origin_phi, floats origin_mass, floats target_pt, floats target_eta, floats target_phi, floats target_mass){
-    FourVectorVec origin, target;
-    ints target_binary;
-    int target_i = -1;
-    float tempdR = 1, dR = maxdR;
+    ints target_binary(target_pt.size(), 0);
+    if( origin_i < 0 || origin_i >= int(origin_pt.size()) ) return target_binary;
 
-    origin = gen4vec(origin_pt, origin_eta, origin_phi, origin_mass);
-    target = gen4vec(target_pt, target_eta, target_phi, target_mass);
+    ObjectCollection origin(origin_pt, origin_eta, origin_phi, origin_mass);
+    ObjectCollection target(target_pt, target_eta, target_phi, target_mass);
+    int target_i = -1;
+    float dR2 = maxdR*maxdR;
 
     for(int i=0; i<int(target.size()); i++){
-        tempdR = ROOT::Math::VectorUtil::DeltaR(origin[origin_i],target[i]); 
-        if( tempdR < dR ){
+        float tempdR2 = origin.deltaR2(origin_i, target, i);
+        if( tempdR2 < dR2 ){
             target_i = i;
-            dR = tempdR;
+            dR2 = tempdR2;
         }
     }
-    for(int j=0; j<int(target.size()); j++){
-        if( j == int(target_i) )target_binary.emplace_back(1);
-        else target_binary.emplace_back(0);
-    }
+    if( target_i >= 0 ) target_binary[target_i] = 1;
     return target_binary;
 }
 
 
+intsVec dRmatching_multi( const ints &gen_idx, const floats &gen_eta, const floats &gen_phi, const dRmatchcollection *recos, int nrecos, const std::vector<dRmatchrequest> &requests){
+    intsVec out(requests.size());
+    for(size_t r=0; r<requests.size(); r++){
+        const dRmatchrequest &req = requests[r];
+        if( req.reco_slot < 0 || req.reco_slot >= nrecos ) continue;
+        const floats &reta = *recos[req.reco_slot].eta;
+        const floats &rphi = *recos[req.reco_slot].phi;
+        ints &target_binary = out[r];
+        target_binary.resize(reta.size(), 0);
+
+        int origin_i = req.gen_slot < int(gen_idx.size()) ? gen_idx[req.gen_slot] : -1;
+        if( origin_i < 0 || origin_i >= int(gen_eta.size()) ) continue;
+
+        const float geta = gen_eta[origin_i];
+        const float gphi = gen_phi[origin_i];
+        int target_i = -1;
+        float dR2 = req.maxdR*req.maxdR;
+        for(int i=0; i<int(reta.size()); i++){
+            float deta = geta - reta[i];
+            float dphi = wrapDeltaPhi(gphi - rphi[i]);
+            float tempdR2 = deta*deta + dphi*dphi;
+            if( tempdR2 < dR2 ){
+                target_i = i;
+                dR2 = tempdR2;
+            }
+        }
+        if( target_i >= 0 ) target_binary[target_i] = 1;
+    }
+    return out;
+}
+
+
 float SumMass( FourVectorVec object1, FourVectorVec object2, FourVectorVec object3){
     FourVector SumV = object1[0] + object2[0] + object3[0];
     float SumM = SumV.M();
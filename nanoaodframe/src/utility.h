@@ -18,14 +18,18 @@ using floatsVec =  ROOT::VecOps::RVec<ROOT::VecOps::RVec<float>>;
 using doubles =  ROOT::VecOps::RVec<double>;
 using doublesVec =  ROOT::VecOps::RVec<ROOT::VecOps::RVec<double>>;
 using ints =  ROOT::VecOps::RVec<int>;
+using intsVec =  ROOT::VecOps::RVec<ROOT::VecOps::RVec<int>>;
 using bools = ROOT::VecOps::RVec<bool>;
 using uchars = ROOT::VecOps::RVec<unsigned char>;
+using shorts = ROOT::VecOps::RVec<short>;
 using strings = ROOT::VecOps::RVec<std::string>;
 
 using FourVector = ROOT::Math::PtEtaPhiMVector;
 using FourVectorVec = std::vector<FourVector>;
 using FourVectorRVec = ROOT::VecOps::RVec<FourVector>;
 
+class GenRecord;
+
 
 struct hist1dinfo
 {
@@ -60,8 +64,13 @@ FourVectorVec genmet4vec(float met_pt, float met_phi);
 // return a vector size equal to length of x all filled with evWeight value
 floats weightv(floats &x, float evWeight);
 
+// eigenvalues of the normalized momentum tensor, ascending (see EventShapes.h for the full set of shapes)
 floats sphericity(FourVectorVec &p);
 
+// Fox-Wolfram moments H_0..H_lmax of p[minj..maxj-1] in a single pass over the pairs, empty for lmax < 0
+doubles foxwolframmoments(int lmax, FourVectorVec &p, int minj=0, int maxj=-1);
+
+// single order, same as foxwolframmoments(l, ...)[l]; 0 for l < 0
 double foxwolframmoment(int l, FourVectorVec &p, int minj=0, int maxj=-1);
 
 ints good_idx(ints good);
@@ -94,14 +103,37 @@ ints find_element(ints vec, int a);
 
 ints find_element_binary( ints vec, int a);
 
+// the versions taking the GenPart arrays build a GenRecord (GenRecord.h) for a single query,
+// use the GenRecord overloads when asking several questions of the same event
 ints LastGenPart_idx( int target_id, ints GenPart_pdgId, ints GenPart_genPartIdxMother);
+ints LastGenPart_idx( int target_id, const GenRecord &rec);
 
 int lastgenpart_idx(int target_i, ints GenPart_pdgId, ints GenPart_genPartIdxMother);
+int lastgenpart_idx(int target_i, const GenRecord &rec);
 
 ints FinalGenPart_idx( ints GenPart_pdgId, ints GenPart_genPartIdxMother);
+ints FinalGenPart_idx( const GenRecord &rec);
 
 ints dRmatching_binary( int origin_i,float maxdR,  floats origin_pt, floats origin_eta, floats origin_phi, floats origin_mass, floats target_pt, floats target_eta, floats target_phi, floats target_mass);
 
+// one gen-reco matching question: gen particle gen_idx[gen_slot] against reco collection reco_slot
+struct dRmatchrequest
+{
+  int gen_slot;
+  int reco_slot;
+  float maxdR;
+};
+
+// reco collection seen by dRmatching_multi, eta/phi are not copied
+struct dRmatchcollection
+{
+  const floats *eta;
+  const floats *phi;
+};
+
+// answers all requests in one pass, out[r] is the dRmatching_binary mask of request r
+intsVec dRmatching_multi( const ints &gen_idx, const floats &gen_eta, const floats &gen_phi, const dRmatchcollection *recos, int nrecos, const std::vector<dRmatchrequest> &requests);
+
 float SumMass( FourVectorVec object1, FourVectorVec object2, FourVectorVec object3);
 
 FourVector select_leadingvec( FourVectorVec &v );
@@ -0,0 +1,262 @@
+//============================================================================
+// Name        : checkeventshapes.cpp
+// Description : Compares the event shapes of EventShapes.h with reference
+//               computations on sample events, before they are used as
+//               DNN inputs.
+//
+// checkeventshapes [-n nevents] [-s seed] [-f skim.root [-t Events]]
+//
+// Events are random sets of 2 to 10 objects, or the jets (Jet_pt, Jet_eta,
+// Jet_phi, Jet_mass) of the first nevents entries of a skim with -f.
+//  - the eigenvalues of the momentum tensors (sphericity, aplanarity, C, D)
+//    are compared with TMatrixDSymEigen on the full symmetric tensor
+//  - thrust, thrust major and minor are compared with an exhaustive search
+//    over the sign combinations of all objects (exact, up to 16 objects)
+// The difference of sphericity() before EventShapes (TMatrixDSym with only
+// the upper triangle filled, so not the tensor of the event) is also
+// reported. The exit code is nonzero if a comparison fails.
+//============================================================================
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TFile.h"
+#include "TMatrixDSym.h"
+#include "TMatrixDSymEigen.h"
+#include "TRandom3.h"
+#include "TTreeReader.h"
+#include "TTreeReaderArray.h"
+#include "TVectorD.h"
+
+#include "EventShapes.h"
+
+using namespace std;
+
+namespace {
+
+// the momenta are floats
+const double tolEigen = 1e-6;
+// above 12 objects EventShapes iterates, a local maximum shows up as a failure
+const double tolThrust = 1e-5;
+const int maxExhaustive = 16;
+
+struct deviation
+{
+    std::string name;
+    double max = 0.0;
+    long nlarge = 0;
+    long n = 0;
+
+    void add(double d, double large)
+    {
+        d = std::fabs(d);
+        max = std::max(max, d);
+        nlarge += d > large;
+        n++;
+    }
+    void print() const
+    {
+        cout << "  " << name << ": max |diff| " << max << ", " << nlarge << " of " << n << " events above tolerance" << endl;
+    }
+};
+
+// descending eigenvalues of the tensor {xx, yy, zz, xy, xz, yz}; upperonly fills the matrix as sphericity() did
+void referenceEigenvalues(const double m[6], double lambda[3], bool upperonly=false)
+{
+    TMatrixDSym t(3);
+    t(0, 0) = m[0];
+    t(1, 1) = m[1];
+    t(2, 2) = m[2];
+    t(0, 1) = m[3];
+    t(0, 2) = m[4];
+    t(1, 2) = m[5];
+    if (!upperonly) {
+        t(1, 0) = m[3];
+        t(2, 0) = m[4];
+        t(2, 1) = m[5];
+    }
+    TVectorD values;
+    t.EigenVectors(values);
+    for (int k=0; k<3; k++) lambda[k] = values[k];
+    std::sort(lambda, lambda+3, [](double a, double b) { return a > b; });
+}
+
+void tensors(const ObjectCollection &objs, double quad[6], double lin[6])
+{
+    double sump2 = 0.0, sump = 0.0;
+    std::fill(quad, quad+6, 0.0);
+    std::fill(lin, lin+6, 0.0);
+    for (size_t i=0; i<objs.size(); i++) {
+        const double x = objs.px()[i], y = objs.py()[i], z = objs.pz()[i];
+        const double t[6] = {x*x, y*y, z*z, x*y, x*z, y*z};
+        const double p = std::sqrt(t[0] + t[1] + t[2]);
+        for (int k=0; k<6; k++) quad[k] += t[k];
+        if (p > 0.0) for (int k=0; k<6; k++) lin[k] += t[k] / p;
+        sump2 += p*p;
+        sump += p;
+    }
+    for (int k=0; k<6; k++) {
+        quad[k] /= sump2;
+        lin[k] /= sump;
+    }
+}
+
+// max over the signs of |sum_i s_i v_i|, and its direction
+double exhaustiveAxis(const std::vector<std::array<double, 3>> &v, double axis[3])
+{
+    const int n = v.size();
+    double best = -1.0;
+    for (long comb=0; comb < (1L << (n-1)); comb++) {
+        double s[3] = {v[0][0], v[0][1], v[0][2]};
+        for (int i=1; i<n; i++) {
+            const double sgn = ((comb >> (i-1)) & 1) ? -1.0 : 1.0;
+            for (int j=0; j<3; j++) s[j] += sgn * v[i][j];
+        }
+        const double norm = std::sqrt(s[0]*s[0] + s[1]*s[1] + s[2]*s[2]);
+        if (norm > best) {
+            best = norm;
+            for (int j=0; j<3; j++) axis[j] = norm > 0.0 ? s[j] / norm : 0.0;
+        }
+    }
+    return best;
+}
+
+// exact thrust, major and minor
+void exhaustiveThrust(const ObjectCollection &objs, double &thrust, double &major, double &minor)
+{
+    std::vector<std::array<double, 3>> v(objs.size());
+    double sump = 0.0;
+    for (size_t i=0; i<objs.size(); i++) {
+        v[i] = {double(objs.px()[i]), double(objs.py()[i]), double(objs.pz()[i])};
+        sump += std::sqrt(v[i][0]*v[i][0] + v[i][1]*v[i][1] + v[i][2]*v[i][2]);
+    }
+    double taxis[3], maxis[3];
+    thrust = exhaustiveAxis(v, taxis) / sump;
+    auto proj = v;
+    for (auto &p : proj) {
+        const double d = p[0]*taxis[0] + p[1]*taxis[1] + p[2]*taxis[2];
+        for (int j=0; j<3; j++) p[j] -= d * taxis[j];
+    }
+    major = exhaustiveAxis(proj, maxis) / sump;
+    const double naxis[3] = {taxis[1]*maxis[2] - taxis[2]*maxis[1],
+                             taxis[2]*maxis[0] - taxis[0]*maxis[2],
+                             taxis[0]*maxis[1] - taxis[1]*maxis[0]};
+    minor = 0.0;
+    for (auto &p : v) minor += std::fabs(p[0]*naxis[0] + p[1]*naxis[1] + p[2]*naxis[2]);
+    minor /= sump;
+}
+
+void usage()
+{
+    cout << "usage: checkeventshapes [-n nevents] [-s seed] [-f skim.root [-t Events]]" << endl;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    long nevents = 10000;
+    unsigned int seed = 4357;
+    std::string fname = "";
+    std::string treename = "Events";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:f:t:h")) != -1) {
+        switch (opt) {
+        case 'n': nevents = atol(optarg); break;
+        case 's': seed = atoi(optarg); break;
+        case 'f': fname = optarg; break;
+        case 't': treename = optarg; break;
+        default: usage(); return EXIT_FAILURE;
+        }
+    }
+
+    std::unique_ptr<TFile> f;
+    std::unique_ptr<TTreeReader> reader;
+    std::unique_ptr<TTreeReaderArray<float>> jetpt, jeteta, jetphi, jetmass;
+    if (fname != "") {
+        f.reset(TFile::Open(fname.c_str()));
+        if (!f || f->IsZombie() || f->Get<TTree>(treename.c_str()) == nullptr) {
+            cout << "ERROR! checkeventshapes: no tree " << treename << " in " << fname << endl;
+            return EXIT_FAILURE;
+        }
+        reader.reset(new TTreeReader(treename.c_str(), f.get()));
+        jetpt.reset(new TTreeReaderArray<float>(*reader, "Jet_pt"));
+        jeteta.reset(new TTreeReaderArray<float>(*reader, "Jet_eta"));
+        jetphi.reset(new TTreeReaderArray<float>(*reader, "Jet_phi"));
+        jetmass.reset(new TTreeReaderArray<float>(*reader, "Jet_mass"));
+    }
+
+    TRandom3 rng(seed);
+    deviation dsph{"sphericity"}, dapl{"aplanarity"}, dc{"C"}, dd{"D"};
+    deviation dthrust{"thrust"}, dmajor{"thrust major"}, dminor{"thrust minor"};
+    deviation dold{"sphericity before EventShapes (upper triangle only)"};
+    long nskipped = 0;
+    for (long ievt=0; ievt<nevents; ievt++) {
+        floats pt, eta, phi, mass;
+        if (reader) {
+            if (!reader->Next()) break;
+            for (size_t i=0; i<jetpt->GetSize(); i++) {
+                pt.push_back((*jetpt)[i]);
+                eta.push_back((*jeteta)[i]);
+                phi.push_back((*jetphi)[i]);
+                mass.push_back((*jetmass)[i]);
+            }
+        } else {
+            const int n = 2 + rng.Integer(9);
+            for (int i=0; i<n; i++) {
+                pt.push_back(20.0 + rng.Exp(60.0));
+                eta.push_back(rng.Uniform(-2.5, 2.5));
+                phi.push_back(rng.Uniform(-M_PI, M_PI));
+                mass.push_back(rng.Uniform(0.0, 20.0));
+            }
+        }
+        if (pt.size() < 2) {
+            nskipped++;
+            continue;
+        }
+        ObjectCollection objs(pt, eta, phi, mass);
+        const eventshapes es = calculateEventShapes(objs);
+
+        double quad[6], lin[6], l[3], lold[3];
+        tensors(objs, quad, lin);
+        referenceEigenvalues(quad, l);
+        for (int k=0; k<3; k++) l[k] = std::max(l[k], 0.0);
+        dsph.add(es.sphericity - 1.5 * (l[1] + l[2]), tolEigen);
+        dapl.add(es.aplanarity - 1.5 * l[2], tolEigen);
+        referenceEigenvalues(quad, lold, true);
+        dold.add(es.sphericity - 1.5 * (lold[1] + lold[2]), tolEigen);
+        referenceEigenvalues(lin, l);
+        for (int k=0; k<3; k++) l[k] = std::max(l[k], 0.0);
+        dc.add(es.C - 3.0 * (l[0]*l[1] + l[0]*l[2] + l[1]*l[2]), tolEigen);
+        dd.add(es.D - 27.0 * l[0]*l[1]*l[2], tolEigen);
+
+        if (objs.size() > maxExhaustive) continue;
+        double thrust, major, minor;
+        exhaustiveThrust(objs, thrust, major, minor);
+        dthrust.add(es.thrust - thrust, tolThrust);
+        dmajor.add(es.thrustmajor - major, tolThrust);
+        dminor.add(es.thrustminor - minor, tolThrust);
+    }
+
+    cout << "checkeventshapes: " << dsph.n << " events (" << nskipped << " with less than two objects skipped)" << endl;
+    cout << "tensor eigenvalues against TMatrixDSymEigen, tolerance " << tolEigen << endl;
+    for (auto d : {&dsph, &dapl, &dc, &dd}) d->print();
+    cout << "thrust axes against the exhaustive search, tolerance " << tolThrust << endl;
+    for (auto d : {&dthrust, &dmajor, &dminor}) d->print();
+    cout << "changed by EventShapes (not a failure)" << endl;
+    dold.print();
+
+    bool ok = dsph.nlarge == 0 && dapl.nlarge == 0 && dc.nlarge == 0 && dd.nlarge == 0
+              && dthrust.nlarge == 0 && dmajor.nlarge == 0 && dminor.nlarge == 0;
+    cout << (ok ? "OK" : "ERROR! event shapes differ from the reference") << endl;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,127 @@
+//============================================================================
+// Name        : checksaveall.cpp
+// Description : Runs the skimming (SkimEvents) or the processing
+//               (TopLFVAnalyzer) on the first entries of an input with
+//               saveAll on, as --saveallbranches does, and reads the
+//               outputs back.
+//
+// checksaveall -f in.root -Y year [-S syst] [-k] [-n nentries] [-o out.root]
+//   -k skims a NanoAOD file, else a skim is processed
+// Every column written by run(saveAll=true) needs a dictionary, so a column
+// of an internal type (ObjectCollection, GenRecord, ...) that is not in
+// workColumns() makes the Snapshot fail. The check fails if run throws, if
+// an output has no Events tree, if an entry cannot be read back, or if a
+// working column was written. Run it on data and on MC after adding columns
+// to the selectors.
+//============================================================================
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TFile.h"
+#include "TTree.h"
+
+#include "NanoAODAnalyzerrdframe.h"
+#include "TopLFVAnalyzer.h"
+#include "SkimEvents.h"
+#include "JobDefaults.h"
+
+using namespace std;
+
+namespace {
+
+void usage()
+{
+    cout << "usage: checksaveall -f in.root -Y year [-S syst] [-k] [-n nentries] [-o out.root]" << endl;
+}
+
+// the tree of outname can be read back and holds none of the working columns
+bool checkOutput(const std::string &outname, const std::vector<std::string> &workcolumns)
+{
+    std::unique_ptr<TFile> f(TFile::Open(outname.c_str()));
+    TTree *t = (f && !f->IsZombie()) ? f->Get<TTree>("Events") : nullptr;
+    if (t == nullptr) {
+        cout << "ERROR! checksaveall: no Events tree in " << outname << endl;
+        return false;
+    }
+    bool ok = true;
+    for (auto &c : workcolumns) {
+        if (t->GetBranch(c.c_str()) != nullptr) {
+            cout << "ERROR! checksaveall: working column " << c << " written to " << outname << endl;
+            ok = false;
+        }
+    }
+    for (Long64_t i=0; i<t->GetEntries(); i++) {
+        if (t->GetEntry(i) < 0) {
+            cout << "ERROR! checksaveall: cannot read entry " << i << " of " << outname << endl;
+            return false;
+        }
+    }
+    cout << "checksaveall: " << outname << ": " << t->GetEntries() << " entries, " << t->GetListOfBranches()->GetEntriesFast() << " branches" << endl;
+    return ok;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    std::string infile = "";
+    std::string outfile = "checksaveall.root";
+    std::string year = "";
+    std::string syst = "";
+    bool skim = false;
+    Long64_t nentries = 1000;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "f:o:Y:S:kn:h")) != -1) {
+        switch (opt) {
+        case 'f': infile = optarg; break;
+        case 'o': outfile = optarg; break;
+        case 'Y': year = optarg; break;
+        case 'S': syst = optarg; break;
+        case 'k': skim = true; break;
+        case 'n': nentries = atoll(optarg); break;
+        default: usage(); return EXIT_FAILURE;
+        }
+    }
+    if (infile == "" || year == "" || nentries <= 0) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    std::unique_ptr<TFile> f(TFile::Open(infile.c_str()));
+    TTree *t = (f && !f->IsZombie()) ? f->Get<TTree>("Events") : nullptr;
+    if (t == nullptr) {
+        cout << "ERROR! checksaveall: no Events tree in " << infile << endl;
+        return EXIT_FAILURE;
+    }
+
+    // the defaults of nanoaodrdataframe
+    bool isdata = syst == "data" || infile.find("SingleMuon") != std::string::npos;
+    std::string json = !skim && isdata ? defaultGoldenJSON(year) : "";
+    std::string globaltag = skim ? defaultGlobalTag(infile, year) : "";
+    std::unique_ptr<NanoAODAnalyzerrdframe> analyzer;
+    if (skim) analyzer.reset(new SkimEvents(t, outfile, year, syst, json, globaltag, 1));
+    else analyzer.reset(new TopLFVAnalyzer(t, outfile, year, syst, json, globaltag, 1));
+    analyzer->setEntryRange(0, std::min(nentries, t->GetEntries()));
+
+    try {
+        analyzer->setupAnalysis();
+        analyzer->run(true, "Events");
+    } catch (std::exception &e) {
+        cout << "ERROR! checksaveall: run(saveAll=true) failed: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    bool ok = !analyzer->outputFiles().empty();
+    for (auto &outname : analyzer->outputFiles()) ok = checkOutput(outname, analyzer->workColumns()) && ok;
+    cout << (ok ? "OK" : "ERROR! the saveAll output cannot be written or read") << endl;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,224 @@
+//============================================================================
+// Name        : dnnscore.cpp
+// Description : Scores processed ntuples (nominal and systematic variations)
+//               with one DNNModel and writes the score to friend trees.
+//
+// dnnscore -m dnn_st.txt [-t outputTree2] [-j nthreads] [-b batchsize] [-s suffix] file1.root file2.root ...
+//
+// For every input x.root a file x<suffix>.root (default suffix "_dnn") is
+// written with a tree "<tree>_dnn" holding the branch dnn_score, entry by
+// entry aligned with the input tree:
+//   t->AddFriend("outputTree2_dnn", "x_dnn.root");
+// The default tree is outputTree2, the tree of the processed ntuples read by
+// DNN/eval.py.
+// Files are distributed over the threads, all threads share the network
+// weights. Only the input branches are read, in batches of fixed size, so the
+// memory use does not depend on the number of events.
+//============================================================================
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TLeaf.h"
+#include "TROOT.h"
+
+#include "DNNModel.h"
+
+using namespace std;
+
+namespace {
+
+// one input branch, converted to float
+struct inputcolumn
+{
+    enum leaftype { kFloat, kDouble, kChar, kUChar, kShort, kUShort, kInt, kUInt, kLong64, kULong64, kBool };
+
+    std::string name;
+    leaftype type = kFloat;
+    union {
+        Float_t f;
+        Double_t d;
+        Char_t c;
+        UChar_t uc;
+        Short_t s;
+        UShort_t us;
+        Int_t i;
+        UInt_t u;
+        Long64_t l;
+        ULong64_t ul;
+        Bool_t b;
+    } value;
+
+    // false for a leaf type that cannot be read
+    bool setType(const std::string &tname)
+    {
+        static const std::map<std::string, leaftype> types = {
+            {"Float_t", kFloat}, {"Double_t", kDouble}, {"Char_t", kChar}, {"UChar_t", kUChar},
+            {"Short_t", kShort}, {"UShort_t", kUShort}, {"Int_t", kInt}, {"UInt_t", kUInt},
+            {"Long64_t", kLong64}, {"ULong64_t", kULong64}, {"Bool_t", kBool}};
+        auto it = types.find(tname);
+        if (it == types.end()) return false;
+        type = it->second;
+        return true;
+    }
+
+    float get() const
+    {
+        switch (type) {
+        case kFloat: return value.f;
+        case kDouble: return value.d;
+        case kChar: return value.c;
+        case kUChar: return value.uc;
+        case kShort: return value.s;
+        case kUShort: return value.us;
+        case kInt: return value.i;
+        case kUInt: return value.u;
+        case kLong64: return value.l;
+        case kULong64: return value.ul;
+        case kBool: return value.b;
+        }
+        return 0.0f;
+    }
+};
+
+bool scoreFile(const DNNModel &model, unsigned int slot, const std::string &infname, const std::string &treename,
+               const std::string &suffix, int batchsize, int node)
+{
+    std::unique_ptr<TFile> infile(TFile::Open(infname.c_str()));
+    if (!infile || infile->IsZombie()) {
+        cout << "ERROR! dnnscore: cannot open " << infname << endl;
+        return false;
+    }
+    TTree *tree = infile->Get<TTree>(treename.c_str());
+    if (tree == nullptr) {
+        cout << "ERROR! dnnscore: no tree " << treename << " in " << infname << endl;
+        return false;
+    }
+
+    const int nin = model.ninputs();
+    std::vector<inputcolumn> columns(nin);
+    tree->SetBranchStatus("*", 0);
+    for (int k=0; k<nin; k++) {
+        columns[k].name = model.inputNames()[k];
+        TLeaf *leaf = tree->GetLeaf(columns[k].name.c_str());
+        if (leaf == nullptr || leaf->GetLenStatic() != 1 || leaf->GetLeafCount() != nullptr) {
+            cout << "ERROR! dnnscore: input " << columns[k].name << " is not a scalar branch of " << infname << endl;
+            return false;
+        }
+        if (!columns[k].setType(leaf->GetTypeName())) {
+            cout << "ERROR! dnnscore: input " << columns[k].name << " has the unsupported type " << leaf->GetTypeName() << " in " << infname << endl;
+            return false;
+        }
+        tree->SetBranchStatus(columns[k].name.c_str(), 1);
+        tree->SetBranchAddress(columns[k].name.c_str(), (void *)&columns[k].value);
+    }
+
+    std::string outfname = infname.substr(0, infname.rfind(".root")) + suffix + ".root";
+    std::unique_ptr<TFile> outfile(TFile::Open(outfname.c_str(), "RECREATE"));
+    if (!outfile || outfile->IsZombie()) {
+        cout << "ERROR! dnnscore: cannot create " << outfname << endl;
+        return false;
+    }
+    // owned by outfile
+    TTree *friendtree = new TTree((treename + "_dnn").c_str(), "DNN score");
+    float score = -1;
+    friendtree->Branch("dnn_score", &score);
+    // flush baskets regularly, so the output is not kept in memory
+    friendtree->SetAutoFlush(-8000000);
+
+    const int nout = model.noutputs();
+    std::vector<float> in(size_t(batchsize) * nin);
+    std::vector<float> out(size_t(batchsize) * nout);
+    const Long64_t nentries = tree->GetEntries();
+    for (Long64_t first=0; first<nentries; first+=batchsize) {
+        const int nbatch = std::min<Long64_t>(batchsize, nentries - first);
+        for (int r=0; r<nbatch; r++) {
+            tree->GetEntry(first + r);
+            float *row = in.data() + size_t(r) * nin;
+            for (int k=0; k<nin; k++) row[k] = columns[k].get();
+        }
+        model.evaluate(slot, in.data(), nbatch, out.data());
+        for (int r=0; r<nbatch; r++) {
+            score = out[size_t(r) * nout + node];
+            friendtree->Fill();
+        }
+    }
+    outfile->cd();
+    friendtree->Write();
+    outfile->Close();
+    cout << "dnnscore: " << nentries << " events of " << infname << " -> " << outfname << endl;
+    return true;
+}
+
+void usage()
+{
+    cout << "usage: dnnscore -m weights.txt [-t tree (default outputTree2)] [-j nthreads] [-b batchsize] [-n node] [-s suffix] files..." << endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string weights = "";
+    std::string treename = "outputTree2";
+    std::string suffix = "_dnn";
+    int nthreads = 1;
+    int batchsize = 1024;
+    int node = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:t:j:b:n:s:h")) != -1) {
+        switch (opt) {
+        case 'm': weights = optarg; break;
+        case 't': treename = optarg; break;
+        case 'j': nthreads = std::max(1, atoi(optarg)); break;
+        case 'b': batchsize = std::max(1, atoi(optarg)); break;
+        case 'n': node = atoi(optarg); break;
+        case 's': suffix = optarg; break;
+        default: usage(); return EXIT_FAILURE;
+        }
+    }
+    std::vector<std::string> files(argv + optind, argv + argc);
+    if (weights == "" || files.empty()) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    nthreads = std::min<int>(nthreads, files.size());
+    const DNNModel model(weights, nthreads);
+    if (!model.isValid() || node < 0 || node >= model.noutputs()) {
+        cout << "ERROR! dnnscore: cannot use output " << node << " of " << weights << endl;
+        return EXIT_FAILURE;
+    }
+
+    // ROOT I/O from several threads
+    ROOT::EnableThreadSafety();
+    std::atomic<size_t> next(0);
+    std::atomic<int> nfailed(0);
+    std::vector<std::thread> workers;
+    for (int slot=0; slot<nthreads; slot++) {
+        workers.emplace_back([&, slot]() {
+            for (size_t i=next++; i<files.size(); i=next++) {
+                if (!scoreFile(model, slot, files[i], treename, suffix, batchsize, node)) nfailed++;
+            }
+        });
+    }
+    for (auto &w : workers) w.join();
+
+    if (nfailed > 0) {
+        cout << "ERROR! dnnscore: " << nfailed << " of " << files.size() << " files failed" << endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
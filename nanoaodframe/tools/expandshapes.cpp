@@ -0,0 +1,75 @@
+//============================================================================
+// Name        : expandshapes.cpp
+// Description : Converts outputs written with dense histograms (ShapeStore,
+//               one TH3D per variable in shapes/) back to one TH1D key per
+//               histogram, for tools that read the old layout (plotIt,
+//               postprocess.py).
+//
+// expandshapes [-l] file1.root file2.root ...
+//
+// The histograms are written into every file under their old names
+// (h_<var>_S<n><syst>) and shapes/ is deleted. With -l the names are only
+// listed.
+//============================================================================
+
+#include <unistd.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TFile.h"
+
+#include "ShapeStore.h"
+
+using namespace std;
+
+void usage()
+{
+    cout << "usage: expandshapes [-l] file1.root file2.root ..." << endl
+         << "  -l   list the histogram names, do not change the files" << endl;
+}
+
+int main(int argc, char **argv)
+{
+    bool list = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "lh")) != -1) {
+        switch (opt) {
+        case 'l': list = true; break;
+        default: usage(); return EXIT_FAILURE;
+        }
+    }
+    std::vector<std::string> files(argv + optind, argv + argc);
+    if (files.empty()) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    int nfailed = 0;
+    for (auto &fname : files) {
+        std::unique_ptr<TFile> f(TFile::Open(fname.c_str(), list ? "READ" : "UPDATE"));
+        if (!f || f->IsZombie()) {
+            cout << "ERROR! expandshapes: cannot open " << fname << endl;
+            nfailed++;
+            continue;
+        }
+        ShapeStore store(f.get());
+        if (!store.isValid()) {
+            cout << "WARNING! expandshapes: no " << ShapeStore::dirName << " in " << fname << ", skipped" << endl;
+            continue;
+        }
+        if (list) {
+            for (auto &name : store.names()) cout << name << endl;
+            continue;
+        }
+        int n = store.expand(f.get());
+        f->Delete((std::string(ShapeStore::dirName) + ";*").c_str());
+        f->Close();
+        cout << fname << ": " << n << " histograms" << endl;
+    }
+    return nfailed > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
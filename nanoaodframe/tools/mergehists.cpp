@@ -0,0 +1,420 @@
+//============================================================================
+// Name        : mergehists.cpp
+// Description : Merges the histogram files of a campaign in one process,
+//               several outputs at a time, instead of one hadd per file
+//               (DNN/haddToMergeBkg.py, haddToMergeSig.py).
+//
+// mergehists -o outdir [-j nthreads] indir1 indir2 ...
+//   every <syst>/<year>/<file>.root found under the input directories (at any
+//   depth) is merged into outdir/<syst>/<year>/<file>.root
+// mergehists -s _st,_tt [-j nthreads] dir
+//   in every directory under dir, <name>_st.root and <name>_tt.root are
+//   merged into <name>.root
+// Other options: -i STR only the paths containing STR, -x STR not the paths
+//                       containing STR (both can be repeated)
+//                -m MB  memory for inputs read in one go, shared by all
+//                       threads (default 4096): an input is read into
+//                       memory if it fits in what the other threads leave,
+//                       else it is opened
+//                -n     list the outputs and their inputs, merge nothing
+//
+// The outputs are merged largest first by nthreads threads. Every input is
+// opened once and read sequentially into memory; its histograms are matched
+// by path and name with those already read and added up, and every output is
+// written once at the end. Groups holding other objects than histograms
+// and directories (e.g. trees) are merged with TFileMerger.
+//============================================================================
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TClass.h"
+#include "TFile.h"
+#include "TFileMerger.h"
+#include "TH1.h"
+#include "TKey.h"
+#include "TList.h"
+#include "TMemFile.h"
+#include "TROOT.h"
+
+using namespace std;
+
+namespace {
+
+struct mergegroup
+{
+    std::string output;
+    std::vector<std::string> inputs;
+    Long64_t bytes = 0;
+};
+
+struct mergedobject
+{
+    std::string dir;
+    std::string name;
+    std::unique_ptr<TH1> h;
+};
+
+std::mutex printlock;
+
+Long64_t fileSize(const std::string &fname)
+{
+    struct stat st;
+    return stat(fname.c_str(), &st) == 0 ? st.st_size : -1;
+}
+
+bool isDirectory(const std::string &path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+void makeDirectories(const std::string &dir)
+{
+    for (size_t pos = dir.find('/', 1); ; pos = dir.find('/', pos+1)) {
+        mkdir(dir.substr(0, pos).c_str(), 0755);
+        if (pos == std::string::npos) break;
+    }
+}
+
+// .root files under dir, as paths relative to dir
+void findRootFiles(const std::string &dir, const std::string &relpath, std::vector<std::string> &files)
+{
+    DIR *d = opendir((dir + "/" + relpath).c_str());
+    if (d == nullptr) {
+        cout << "ERROR! mergehists: cannot read directory " << dir << "/" << relpath << endl;
+        return;
+    }
+    std::vector<std::string> names;
+    while (struct dirent *entry = readdir(d)) {
+        std::string name = entry->d_name;
+        if (name != "." && name != "..") names.push_back(name);
+    }
+    closedir(d);
+    std::sort(names.begin(), names.end());
+    for (auto &name : names) {
+        std::string rel = relpath == "" ? name : relpath + "/" + name;
+        if (isDirectory(dir + "/" + rel)) findRootFiles(dir, rel, files);
+        else if (name.size() > 5 && name.compare(name.size()-5, 5, ".root") == 0) files.push_back(rel);
+    }
+}
+
+// a path with one of the includes (if any) and none of the skips
+bool selected(const std::string &path, const std::vector<std::string> &includes, const std::vector<std::string> &skips)
+{
+    auto contains = [&](const std::string &s) { return path.find(s) != std::string::npos; };
+    return (includes.empty() || std::any_of(includes.begin(), includes.end(), contains)) && std::none_of(skips.begin(), skips.end(), contains);
+}
+
+// one group per relative path found in any input directory
+std::vector<mergegroup> groupByPath(const std::vector<std::string> &indirs, const std::string &outdir,
+                                    const std::vector<std::string> &includes, const std::vector<std::string> &skips)
+{
+    std::map<std::string, mergegroup> groups;
+    for (auto &indir : indirs) {
+        std::vector<std::string> files;
+        findRootFiles(indir, "", files);
+        for (auto &rel : files) {
+            if (!selected(rel, includes, skips)) continue;
+            mergegroup &g = groups[rel];
+            g.output = outdir + "/" + rel;
+            g.inputs.push_back(indir + "/" + rel);
+        }
+    }
+    std::vector<mergegroup> result;
+    for (auto &g : groups) result.push_back(g.second);
+    return result;
+}
+
+// one group per <name> with files <name><suffix>.root in the same directory
+std::vector<mergegroup> groupBySuffix(const std::string &dir, const std::vector<std::string> &suffixes,
+                                      const std::vector<std::string> &includes, const std::vector<std::string> &skips)
+{
+    std::vector<std::string> files;
+    findRootFiles(dir, "", files);
+    std::map<std::string, std::vector<std::string>> found;
+    for (auto &rel : files) {
+        if (!selected(rel, includes, skips)) continue;
+        const std::string stem = rel.substr(0, rel.size()-5);
+        for (size_t i=0; i<suffixes.size(); i++) {
+            const std::string &s = suffixes[i];
+            if (stem.size() <= s.size() || stem.compare(stem.size()-s.size(), s.size(), s) != 0) continue;
+            auto &inputs = found[stem.substr(0, stem.size()-s.size())];
+            inputs.resize(suffixes.size());
+            inputs[i] = dir + "/" + rel;
+            break;
+        }
+    }
+    std::vector<mergegroup> result;
+    for (auto &f : found) {
+        mergegroup g;
+        g.output = dir + "/" + f.first + ".root";
+        for (auto &input : f.second) {
+            if (input != "") g.inputs.push_back(input);
+        }
+        if (g.inputs.size() < suffixes.size()) cout << "WARNING! mergehists: " << g.output << " has only " << g.inputs.size() << " of " << suffixes.size() << " inputs" << endl;
+        result.push_back(g);
+    }
+    return result;
+}
+
+// bytes of the inputs held in memory by all threads, at most limit
+class MemoryBudget {
+public:
+    explicit MemoryBudget(Long64_t limit) : _limit(limit) {}
+    bool reserve(Long64_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        if (_used + bytes > _limit) return false;
+        _used += bytes;
+        return true;
+    }
+    void release(Long64_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _used -= bytes;
+    }
+
+private:
+    std::mutex _lock;
+    Long64_t _limit;
+    Long64_t _used = 0;
+};
+
+// an input read into memory, its bytes are given back to the budget when it is closed
+struct inputbuffer
+{
+    MemoryBudget &budget;
+    std::vector<char> data;
+    Long64_t reserved = 0;
+
+    explicit inputbuffer(MemoryBudget &b) : budget(b) {}
+    ~inputbuffer() { budget.release(reserved); }
+};
+
+// histograms of one output, matched by directory and name across the inputs
+class HistogramMerger {
+public:
+    enum status { added, notmergeable, failed };
+
+    // notmergeable if dir holds anything but histograms and directories,
+    // failed if a histogram cannot be added to the one of the same name
+    status add(TDirectory *dir, const std::string &path)
+    {
+        std::set<std::string> seen;
+        for (auto obj : *dir->GetListOfKeys()) {
+            std::string name = obj->GetName();
+            // the highest cycle only
+            if (!seen.insert(name).second) continue;
+            TKey *key = dir->GetKey(name.c_str());
+            TClass *cl = TClass::GetClass(key->GetClassName());
+            if (cl != nullptr && cl->InheritsFrom(TDirectory::Class())) {
+                std::string subpath = path == "" ? name : path + "/" + name;
+                if (std::find(_dirs.begin(), _dirs.end(), subpath) == _dirs.end()) _dirs.push_back(subpath);
+                status st = add(dir->GetDirectory(name.c_str()), subpath);
+                if (st != added) return st;
+                continue;
+            }
+            if (cl == nullptr || !cl->InheritsFrom(TH1::Class())) return notmergeable;
+            std::unique_ptr<TH1> h(static_cast<TH1 *>(key->ReadObj()));
+            h->SetDirectory(nullptr);
+            auto it = _index.find(path + "/" + name);
+            if (it == _index.end()) {
+                _index[path + "/" + name] = _objects.size();
+                _objects.push_back({path, name, std::move(h)});
+            } else {
+                TList others;
+                others.Add(h.get());
+                // -1 for incompatible histograms (e.g. other binning), the sum would be wrong
+                if (_objects[it->second].h->Merge(&others) < 0) {
+                    std::lock_guard<std::mutex> lock(printlock);
+                    cout << "ERROR! mergehists: cannot add " << path << "/" << name << " of " << dir->GetFile()->GetName() << endl;
+                    return failed;
+                }
+            }
+        }
+        return added;
+    }
+
+    bool write(const std::string &outname) const
+    {
+        std::unique_ptr<TFile> out(TFile::Open(outname.c_str(), "RECREATE"));
+        if (!out || out->IsZombie()) return false;
+        for (auto &d : _dirs) out->mkdir(d.c_str(), "", true);
+        for (auto &o : _objects) {
+            TDirectory *d = o.dir == "" ? out.get() : out->GetDirectory(o.dir.c_str());
+            d->WriteTObject(o.h.get(), o.name.c_str());
+        }
+        out->Close();
+        return true;
+    }
+
+    size_t size() const { return _objects.size(); }
+
+private:
+    std::vector<std::string> _dirs;
+    std::vector<mergedobject> _objects;
+    std::map<std::string, size_t> _index;
+};
+
+// the whole file in one read, no seeks on the (network) file system
+// if it fits in the memory budget; buffer must outlive the file
+std::unique_ptr<TFile> openInput(const std::string &fname, inputbuffer &buffer)
+{
+    Long64_t size = fileSize(fname);
+    if (size > 0 && buffer.budget.reserve(size)) {
+        buffer.reserved = size;
+        std::ifstream in(fname, std::ios::binary);
+        buffer.data.resize(size);
+        if (in.read(buffer.data.data(), size)) {
+            return std::unique_ptr<TFile>(new TMemFile(fname.c_str(), TMemFile::ZeroCopyView_t(buffer.data.data(), size)));
+        }
+    }
+    std::vector<char>().swap(buffer.data);
+    buffer.budget.release(buffer.reserved);
+    buffer.reserved = 0;
+    return std::unique_ptr<TFile>(TFile::Open(fname.c_str()));
+}
+
+bool mergeWithFileMerger(const mergegroup &g)
+{
+    TFileMerger merger(false);
+    merger.SetPrintLevel(0);
+    if (!merger.OutputFile(g.output.c_str(), "RECREATE")) return false;
+    for (auto &input : g.inputs) {
+        if (!merger.AddFile(input.c_str(), false)) return false;
+    }
+    return merger.Merge();
+}
+
+bool mergeGroup(const mergegroup &g, MemoryBudget &budget)
+{
+    makeDirectories(g.output.substr(0, g.output.rfind('/')));
+    HistogramMerger merger;
+    for (auto &input : g.inputs) {
+        inputbuffer buffer(budget);
+        auto f = openInput(input, buffer);
+        if (!f || f->IsZombie()) {
+            std::lock_guard<std::mutex> lock(printlock);
+            cout << "ERROR! mergehists: cannot open " << input << endl;
+            return false;
+        }
+        HistogramMerger::status st = merger.add(f.get(), "");
+        if (st == HistogramMerger::failed) return false;
+        if (st == HistogramMerger::notmergeable) {
+            {
+                std::lock_guard<std::mutex> lock(printlock);
+                cout << "mergehists: " << input << " holds other objects than histograms, merging " << g.output << " with TFileMerger" << endl;
+            }
+            return mergeWithFileMerger(g);
+        }
+    }
+    return merger.write(g.output);
+}
+
+void usage()
+{
+    cout << "usage: mergehists -o outdir [-i only] [-x skip] [-j nthreads] indir1 indir2 ..." << endl
+         << "       mergehists -s suffix1,suffix2 [-i only] [-x skip] [-j nthreads] dir" << endl
+         << "  -o DIR      merge the files with the same path under the input directories into DIR" << endl
+         << "  -i STRING   only the paths containing STRING, can be repeated" << endl
+         << "  -x STRING   skip the paths containing STRING, can be repeated" << endl
+         << "  -s LIST     merge <name><suffix>.root of every suffix into <name>.root" << endl
+         << "  -j N        number of outputs merged at a time (default 1)" << endl
+         << "  -m MB       memory for inputs read in one go, shared by the threads (default 4096)" << endl
+         << "  -n          list the outputs and their inputs only" << endl;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    std::string outdir = "";
+    std::vector<std::string> includes;
+    std::vector<std::string> skips;
+    std::vector<std::string> suffixes;
+    int nthreads = 1;
+    Long64_t maxbytes = 4096LL << 20;
+    bool dry = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "o:i:x:s:j:m:nh")) != -1) {
+        switch (opt) {
+        case 'o': outdir = optarg; break;
+        case 'i': includes.push_back(optarg); break;
+        case 'x': skips.push_back(optarg); break;
+        case 's': {
+            std::istringstream list(optarg);
+            for (std::string s; std::getline(list, s, ',');) {
+                if (s != "") suffixes.push_back(s);
+            }
+            break;
+        }
+        case 'j': nthreads = std::max(1, atoi(optarg)); break;
+        case 'm': maxbytes = std::max(0LL, atoll(optarg)) << 20; break;
+        case 'n': dry = true; break;
+        default: usage(); return EXIT_FAILURE;
+        }
+    }
+    std::vector<std::string> indirs(argv + optind, argv + argc);
+    if (indirs.empty() || (outdir == "") == suffixes.empty() || (!suffixes.empty() && indirs.size() != 1)) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    std::vector<mergegroup> groups = suffixes.empty() ? groupByPath(indirs, outdir, includes, skips)
+                                                   : groupBySuffix(indirs[0], suffixes, includes, skips);
+    for (auto &g : groups) {
+        for (auto &input : g.inputs) g.bytes += std::max(0LL, fileSize(input));
+    }
+    std::stable_sort(groups.begin(), groups.end(), [](const mergegroup &a, const mergegroup &b) { return a.bytes > b.bytes; });
+    cout << "mergehists: " << groups.size() << " outputs" << endl;
+    if (dry) {
+        for (auto &g : groups) {
+            cout << g.output;
+            for (auto &input : g.inputs) cout << " " << input;
+            cout << endl;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    MemoryBudget budget(maxbytes);
+    ROOT::EnableThreadSafety();
+    TH1::AddDirectory(false);
+    std::atomic<size_t> next(0);
+    std::atomic<int> nfailed(0);
+    std::vector<std::thread> workers;
+    for (int w=0; w<std::min<int>(nthreads, groups.size()); w++) {
+        workers.emplace_back([&]() {
+            for (size_t i = next++; i < groups.size(); i = next++) {
+                bool ok = mergeGroup(groups[i], budget);
+                std::lock_guard<std::mutex> lock(printlock);
+                if (!ok) {
+                    cout << "ERROR! mergehists: merging " << groups[i].output << " failed" << endl;
+                    nfailed++;
+                } else {
+                    cout << "[" << i+1 << "/" << groups.size() << "] " << groups[i].output << " (" << groups[i].inputs.size() << " inputs)" << endl;
+                }
+            }
+        });
+    }
+    for (auto &w : workers) w.join();
+
+    if (nfailed > 0) cout << "ERROR! mergehists: " << nfailed << " of " << groups.size() << " outputs failed" << endl;
+    return nfailed > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,356 @@
+//============================================================================
+// Name        : runtasks.cpp
+// Description : Runs a list of nanoaodrdataframe jobs on one node, a fixed
+//               number at a time, largest first.
+//
+// runtasks -m tasks.txt -Y year -O outdir [-j nworkers] [-t threadspertask]
+//          [--mem MB] [--retries N] [--skim] [--exe ./nanoaodrdataframe] [--dry]
+//
+// One task per line of the manifest, '#' starts a comment:
+//   <dataset> <input file or directory> <syst> [extra nanoaodrdataframe options]
+// Processing writes outdir/hist_<dataset>[_<file>][__<syst>].root, with the
+// systematic suffix of scripts/process.py (none for all, theory, data and
+// nosyst); skims write outdir/<dataset>/<file>.root.
+//
+// The entries of every input are counted first and the tasks are started
+// largest first, so the long ones do not end up last. Every task is a child
+// process with its own log (outdir/log/<output>.log). With --mem the
+// resident memory of every task is checked every second and a task above
+// the limit is killed (an address space limit would stop ROOT at startup,
+// it reserves far more than it uses). Failed tasks are started again up to
+// --retries times; they run with --checkpoint, so a retry continues where
+// the attempt stopped.
+// At the end outdir/summary.txt lists every task with its status, attempts,
+// entries, wall time and peak memory.
+//============================================================================
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TFile.h"
+#include "TTree.h"
+
+using namespace std;
+
+namespace {
+
+struct task
+{
+    std::string dataset;
+    std::string input;
+    std::string syst;
+    std::vector<std::string> extra;
+    std::string output;
+    Long64_t entries = 0;
+
+    int attempts = 0;
+    int status = -1;        // exit code of the last attempt, 128+signal if killed
+    double seconds = 0;     // wall time of all attempts
+    long maxrssmb = 0;      // peak resident memory over the attempts
+    bool overmem = false;   // the last attempt was killed for exceeding --mem
+};
+
+bool isDirectory(const std::string &path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+// .root files of a directory, or the file itself
+std::vector<std::string> inputFiles(const std::string &input)
+{
+    std::vector<std::string> files;
+    DIR *dir = opendir(input.c_str());
+    if (dir == nullptr) {
+        files.push_back(input);
+        return files;
+    }
+    for (struct dirent *e = readdir(dir); e != nullptr; e = readdir(dir)) {
+        std::string name = e->d_name;
+        if (name.size() > 5 && name.compare(name.size()-5, 5, ".root") == 0) files.push_back(input + "/" + name);
+    }
+    closedir(dir);
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+Long64_t countEntries(const std::string &input)
+{
+    Long64_t n = 0;
+    for (auto &fname : inputFiles(input)) {
+        std::unique_ptr<TFile> f(TFile::Open(fname.c_str()));
+        TTree *t = (f && !f->IsZombie()) ? f->Get<TTree>("Events") : nullptr;
+        if (t != nullptr) n += t->GetEntries();
+    }
+    return n;
+}
+
+std::string baseName(std::string path)
+{
+    while (path.size() > 1 && path.back() == '/') path.pop_back();
+    path = path.substr(path.rfind('/') + 1);
+    if (path.size() > 5 && path.compare(path.size()-5, 5, ".root") == 0) path.resize(path.size()-5);
+    return path;
+}
+
+std::string outputName(const task &t, const std::string &outdir, bool skim)
+{
+    if (skim) return outdir + "/" + t.dataset + "/" + baseName(t.input) + ".root";
+    std::string name = "hist_" + t.dataset;
+    if (!isDirectory(t.input)) name += "_" + baseName(t.input);
+    if (t.syst != "all" && t.syst != "theory" && t.syst != "data" && t.syst != "nosyst" && t.syst != "") name += "__" + t.syst;
+    return outdir + "/" + name + ".root";
+}
+
+bool readManifest(const std::string &fname, std::vector<task> &tasks)
+{
+    std::ifstream in(fname);
+    if (!in.good()) {
+        cout << "ERROR! runtasks: cannot read " << fname << endl;
+        return false;
+    }
+    std::string line;
+    int lineno = 0;
+    while (std::getline(in, line)) {
+        lineno++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        task t;
+        if (!(words >> t.dataset)) continue;
+        if (!(words >> t.input >> t.syst)) {
+            cout << "ERROR! runtasks: " << fname << ":" << lineno << " should be <dataset> <input> <syst> [options]" << endl;
+            return false;
+        }
+        for (std::string w; words >> w; ) t.extra.push_back(w);
+        tasks.push_back(t);
+    }
+    return true;
+}
+
+std::vector<std::string> command(const task &t, const std::string &exe, const std::string &year, int nthreads, bool skim)
+{
+    std::vector<std::string> args = {exe, "--checkpoint", "-Y", year, "-j", std::to_string(nthreads), "-O", t.output};
+    if (skim) args.push_back("--skim");
+    else args.insert(args.end(), {"-S", t.syst});
+    args.insert(args.end(), {isDirectory(t.input) ? "-D" : "-I", t.input});
+    args.insert(args.end(), t.extra.begin(), t.extra.end());
+    return args;
+}
+
+std::string joined(const std::vector<std::string> &args)
+{
+    std::string s = "";
+    for (auto &a : args) s += (s == "" ? "" : " ") + a;
+    return s;
+}
+
+// resident memory of a running process, 0 if unknown
+long residentMB(pid_t pid)
+{
+    std::ifstream statm("/proc/" + std::to_string(pid) + "/statm");
+    long size, resident;
+    if (!(statm >> size >> resident)) return 0;
+    return resident * (sysconf(_SC_PAGESIZE) / 1024) / 1024;
+}
+
+// forks and execs the task with its output in logname, returns the pid
+pid_t start(const std::vector<std::string> &args, const std::string &logname)
+{
+    pid_t pid = fork();
+    if (pid != 0) return pid;
+
+    int fd = open(logname.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd >= 0) {
+        dup2(fd, STDOUT_FILENO);
+        dup2(fd, STDERR_FILENO);
+        close(fd);
+    }
+    std::vector<char *> argv;
+    for (auto &a : args) argv.push_back(const_cast<char *>(a.c_str()));
+    argv.push_back(nullptr);
+    execv(argv[0], argv.data());
+    perror(("runtasks: cannot run " + args[0]).c_str());
+    _exit(127);
+}
+
+void writeSummary(const std::vector<task> &tasks, std::ostream &out)
+{
+    int nfailed = 0;
+    double cpu = 0;
+    out << std::left << std::setw(8) << "status" << std::setw(9) << "attempts" << std::setw(12) << "entries"
+        << std::setw(10) << "wall[s]" << std::setw(10) << "rss[MB]" << "output" << endl;
+    for (auto &t : tasks) {
+        std::string status = t.status == 0 ? "ok" : (t.attempts == 0 ? "skipped" : (t.overmem ? "MEMORY" : "FAILED(" + std::to_string(t.status) + ")"));
+        if (t.status != 0) nfailed++;
+        cpu += t.seconds;
+        out << std::left << std::setw(8) << status << std::setw(9) << t.attempts << std::setw(12) << t.entries
+            << std::setw(10) << std::fixed << std::setprecision(0) << t.seconds << std::setw(10) << t.maxrssmb << t.output << endl;
+    }
+    out << tasks.size() - nfailed << " of " << tasks.size() << " tasks done, " << nfailed << " failed, "
+        << std::fixed << std::setprecision(0) << cpu << " s in tasks" << endl;
+}
+
+void usage()
+{
+    cout << "usage: runtasks -m tasks.txt -Y year -O outdir [-j nworkers] [-t threadspertask] [--mem MB] [--retries N]" << endl
+         << "                [--skim] [--exe ./nanoaodrdataframe] [--dry]" << endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string manifest = "";
+    std::string year = "";
+    std::string outdir = "";
+    std::string exe = "./nanoaodrdataframe";
+    int nworkers = 1;
+    int nthreads = 1;
+    long memmb = 0;
+    int retries = 1;
+    bool skim = false;
+    bool dry = false;
+
+    enum { kMem = 1000, kRetries, kSkim, kExe, kDry };
+    const struct option longopts[] = {
+        {"manifest", required_argument, nullptr, 'm'},
+        {"year", required_argument, nullptr, 'Y'},
+        {"outdir", required_argument, nullptr, 'O'},
+        {"nworkers", required_argument, nullptr, 'j'},
+        {"threads", required_argument, nullptr, 't'},
+        {"mem", required_argument, nullptr, kMem},
+        {"retries", required_argument, nullptr, kRetries},
+        {"skim", no_argument, nullptr, kSkim},
+        {"exe", required_argument, nullptr, kExe},
+        {"dry", no_argument, nullptr, kDry},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "m:Y:O:j:t:h", longopts, nullptr)) != -1) {
+        switch (opt) {
+        case 'm': manifest = optarg; break;
+        case 'Y': year = optarg; break;
+        case 'O': outdir = optarg; break;
+        case 'j': nworkers = std::max(1, atoi(optarg)); break;
+        case 't': nthreads = std::max(1, atoi(optarg)); break;
+        case kMem: memmb = atol(optarg); break;
+        case kRetries: retries = std::max(0, atoi(optarg)); break;
+        case kSkim: skim = true; break;
+        case kExe: exe = optarg; break;
+        case kDry: dry = true; break;
+        default: usage(); return EXIT_FAILURE;
+        }
+    }
+    std::vector<task> tasks;
+    if (manifest == "" || year == "" || outdir == "") {
+        usage();
+        return EXIT_FAILURE;
+    }
+    if (!readManifest(manifest, tasks)) return EXIT_FAILURE;
+
+    const std::string logdir = outdir + "/log";
+    mkdir(outdir.c_str(), 0755);
+    mkdir(logdir.c_str(), 0755);
+    std::map<std::string, int> outputs;
+    for (auto &t : tasks) {
+        t.output = outputName(t, outdir, skim);
+        if (skim) mkdir((outdir + "/" + t.dataset).c_str(), 0755);
+        if (outputs[t.output]++ > 0) {
+            cout << "ERROR! runtasks: two tasks write " << t.output << endl;
+            return EXIT_FAILURE;
+        }
+        t.entries = countEntries(t.input);
+    }
+
+    // largest first; tasks waiting for a retry keep their place
+    std::vector<size_t> pending(tasks.size());
+    for (size_t i=0; i<tasks.size(); i++) pending[i] = i;
+    auto larger = [&tasks](size_t a, size_t b) { return tasks[a].entries > tasks[b].entries; };
+    std::stable_sort(pending.begin(), pending.end(), larger);
+    cout << "runtasks: " << tasks.size() << " tasks, " << nworkers << " workers" << (memmb > 0 ? ", " + std::to_string(memmb) + " MB each" : "") << endl;
+    if (dry) {
+        for (size_t i : pending) cout << tasks[i].entries << "\t" << joined(command(tasks[i], exe, year, nthreads, skim)) << endl;
+        return EXIT_SUCCESS;
+    }
+
+    using clock = std::chrono::steady_clock;
+    struct running { size_t idx; clock::time_point started; };
+    std::map<pid_t, running> children;
+    while (!pending.empty() || !children.empty()) {
+        while (!pending.empty() && int(children.size()) < nworkers) {
+            task &t = tasks[pending.front()];
+            auto args = command(t, exe, year, nthreads, skim);
+            t.attempts++;
+            cout << "runtasks: start (" << t.attempts << ") " << joined(args) << endl;
+            t.overmem = false;
+            pid_t pid = start(args, logdir + "/" + baseName(t.output) + ".log");
+            if (pid < 0) {
+                cout << "ERROR! runtasks: cannot fork" << endl;
+                break;
+            }
+            children[pid] = {pending.front(), clock::now()};
+            pending.erase(pending.begin());
+        }
+        if (children.empty()) break;
+
+        int wstatus;
+        struct rusage usage;
+        pid_t pid = wait4(-1, &wstatus, memmb > 0 ? WNOHANG : 0, &usage);
+        if (pid < 0) break;
+        if (pid == 0) {
+            // all tasks still running: kill those above the memory limit, they are reaped by the next wait4
+            for (auto &c : children) {
+                task &t = tasks[c.second.idx];
+                long rss = residentMB(c.first);
+                if (rss <= memmb || t.overmem) continue;
+                cout << "WARNING! runtasks: " << t.output << " uses " << rss << " MB, more than --mem " << memmb << " MB, killed" << endl;
+                t.overmem = true;
+                kill(c.first, SIGKILL);
+            }
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            continue;
+        }
+        auto child = children.find(pid);
+        if (child == children.end()) continue;
+        task &t = tasks[child->second.idx];
+        t.seconds += std::chrono::duration<double>(clock::now() - child->second.started).count();
+        t.maxrssmb = std::max(t.maxrssmb, usage.ru_maxrss / 1024);
+        t.status = WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) : 128 + WTERMSIG(wstatus);
+        if (t.status == 0) {
+            cout << "runtasks: done " << t.output << endl;
+        } else if (t.attempts <= retries) {
+            cout << "WARNING! runtasks: " << t.output << " failed with status " << t.status << ", retrying" << endl;
+            pending.insert(std::upper_bound(pending.begin(), pending.end(), child->second.idx, larger), child->second.idx);
+        } else {
+            cout << "ERROR! runtasks: " << t.output << " failed with status " << t.status << ", see " << logdir << endl;
+        }
+        children.erase(child);
+    }
+
+    std::ofstream summary(outdir + "/summary.txt");
+    writeSummary(tasks, summary);
+    writeSummary(tasks, cout);
+    bool ok = std::all_of(tasks.begin(), tasks.end(), [](const task &t) { return t.status == 0; });
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}